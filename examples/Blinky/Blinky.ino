@@ -24,6 +24,10 @@ bool xNextButton() {
 	return (digitalRead(NEXT_BUTTON) == LOW);
 }
 
+// State callbacks, defined below
+void onEntering();
+void onLeaving();
+
 // Create new Finite State Machine
 StateMachine myFSM;
 
@@ -63,10 +63,10 @@ bool xNextButton() {
 // Definition of the model of the finite state machine and start execution
 void setupStateMachine(){
 	// Create some states and assign name and callback functions
-	State* blinkOff = myFSM.addState(F("BlinkOFF"), 0, 500, onEntering, onLeaving, nullptr);
-	State* blink1 = myFSM.addState(F("Blink1"), onEntering, onLeaving, nullptr);
-	State* blink2 = myFSM.addState(F("Blink2"), 0, 500, onEntering, onLeaving, nullptr);
-	State* blink3 = myFSM.addState(F("Blink3"), 0, 500, onEntering, onLeaving, nullptr);
+	State* blinkOff = myFSM.addState(F("BlinkOFF"), 500, 0, onEntering, onLeaving, nullptr);
+	State* blink1 = myFSM.addState(F("Blink1"), 500, 0, onEntering, onLeaving, nullptr);
+	State* blink2 = myFSM.addState(F("Blink2"), 500, 0, onEntering, onLeaving, nullptr);
+	State* blink3 = myFSM.addState(F("Blink3"), 500, 0, onEntering, onLeaving, nullptr);
 
 	// Add transitions to target state and trigger condition (callback function or bool var)
 	blink1->addTransition(blink2, xNextButton);			// xNextButton is a callback function
@@ -0,0 +1,95 @@
+/*
+* Two start/stop motors (as in StartStopMotor.ino) and a slow monitor machine run by a MachineRunner
+* with a budget of 500 us for each call: a slow callback can't delay the motors for more than one machine at a time.
+* Every 5 seconds the worst execute() time of each machine and the number of overruns are printed.
+*/
+
+#include <MachineRunner.h>
+
+#define START_BUTTON_1  4
+#define STOP_BUTTON_1   5
+#define START_BUTTON_2  6
+#define STOP_BUTTON_2   7
+#define OUT_MOTOR_1     12
+#define OUT_MOTOR_2     13
+
+StateMachine motor1, motor2, monitor;
+StateMachine *const machines[] = {&motor1, &motor2, &monitor};
+MachineRunner runner(machines, 500);
+
+// Input/Output State Machine interface
+bool inStart1, inStop1, inStart2, inStop2;
+bool outMotor1, outMotor2;
+
+void setupMotor(StateMachine &fsm, bool &inStart, bool &inStop, bool &outMotor) {
+	State *stIdle = fsm.addState("IDLE", nullptr);
+	State *stRun = fsm.addState("RUN", 5000, nullptr);
+	State *stStop = fsm.addState("STOP", 1000, nullptr);
+
+	stIdle->addTransition(stRun, inStart);
+	stRun->addTransition(stStop, inStop);
+	stStop->addTransition(stIdle, 1000);
+
+	stRun->addAction(Action::Type::S, outMotor);
+	stStop->addAction(Action::Type::R, outMotor);
+
+	fsm.setInitialState(stIdle);
+	fsm.start();
+}
+
+// A slow task (i.e. a sensor read with a long conversion time)
+void readSensor() {
+	delayMicroseconds(800);
+}
+
+void printStats() {
+	for (uint8_t i = 0; i < 3; i++) {
+		Serial.print(F("Machine "));
+		Serial.print(i);
+		Serial.print(F(" max execute: "));
+		Serial.print(runner.getMaxDuration(i));
+		Serial.println(F(" us"));
+	}
+	Serial.print(F("Longest run: "));
+	Serial.print(runner.getMaxRunDuration());
+	Serial.print(F(" us, overruns: "));
+	Serial.println(runner.getOverruns());
+	runner.resetStats();
+}
+
+void setupMonitor() {
+	State *stRead = monitor.addState("READ", nullptr, nullptr, readSensor);
+	State *stReport = monitor.addState("REPORT", printStats);
+	stRead->addTransition(stReport, 5000);
+	stReport->addTransition(stRead, 1);
+	monitor.setInitialState(stRead);
+	monitor.start();
+}
+
+
+void setup() {
+	pinMode(START_BUTTON_1, INPUT_PULLUP);
+	pinMode(STOP_BUTTON_1, INPUT_PULLUP);
+	pinMode(START_BUTTON_2, INPUT_PULLUP);
+	pinMode(STOP_BUTTON_2, INPUT_PULLUP);
+	pinMode(OUT_MOTOR_1, OUTPUT);
+	pinMode(OUT_MOTOR_2, OUTPUT);
+
+	Serial.begin(115200);
+	setupMotor(motor1, inStart1, inStop1, outMotor1);
+	setupMotor(motor2, inStart2, inStop2, outMotor2);
+	setupMonitor();
+}
+
+
+void loop() {
+	inStart1 = (digitalRead(START_BUTTON_1) == LOW) && !outMotor1;
+	inStop1 = (digitalRead(STOP_BUTTON_1) == LOW) && outMotor1;
+	inStart2 = (digitalRead(START_BUTTON_2) == LOW) && !outMotor2;
+	inStop2 = (digitalRead(STOP_BUTTON_2) == LOW) && outMotor2;
+
+	runner.run();
+
+	digitalWrite(OUT_MOTOR_1, outMotor1);
+	digitalWrite(OUT_MOTOR_2, outMotor2);
+}
@@ -0,0 +1,89 @@
+/*
+* Pedestrian traffic light (as in PedestrianLight.ino) with the whole crossing sequence written as the coroutine body
+* of a single state: call delay -> yellow -> red -> green blinking, then back to the green state.
+* Needs a C++20 compiler with coroutines (i.e. ESP32 with build flag -std=gnu++20).
+*/
+
+#include <StateTask.h>
+
+const byte BTN_CALL   = 2;
+const byte GREEN_LED  = 12;
+const byte YELLOW_LED = 11;
+const byte RED_LED    = 10;
+
+const uint32_t MIN_GREEN   = 3000;
+const uint32_t CALL_DELAY  = 5000;
+const uint32_t YELLOW_TIME = 5000;
+const uint32_t RED_TIME    = 10000;
+
+// The Finite State Machine
+StateMachine fsm;
+
+// Input/Output State Machine interface
+bool inCallButton;
+bool outRed, outGreen, outYellow;
+
+
+StateTask crossing() {
+	Serial.println(F("Call registered, please wait a little time."));
+	co_await taskDelay(CALL_DELAY);
+
+	outGreen = false;
+	outYellow = true;
+	co_await taskDelay(YELLOW_TIME);
+
+	outYellow = false;
+	outRed = true;
+	co_await taskDelay(RED_TIME);
+
+	// Red and blinking green before the end of crossing
+	for (uint8_t i = 0; i < 5; i++) {
+		outGreen = true;
+		co_await taskDelay(300);
+		outGreen = false;
+		co_await taskDelay(300);
+	}
+	outRed = false;
+}
+
+State stGreen("Green", MIN_GREEN, nullptr);     // Cars have green for some time after each crossing
+CoState stCrossing("Crossing", crossing);
+
+
+void setup() {
+	pinMode(BTN_CALL, INPUT_PULLUP);
+	pinMode(GREEN_LED, OUTPUT);
+	pinMode(YELLOW_LED, OUTPUT);
+	pinMode(RED_LED, OUTPUT);
+
+	Serial.begin(115200);
+	Serial.println("Starting State Machine...");
+
+	fsm.addState(stGreen);
+	fsm.addState(stCrossing);
+
+	stGreen.addTransition(&stCrossing, inCallButton);
+	stCrossing.addTransition(&stGreen, CoState::done);
+	stGreen.addAction(Action::Type::S, outGreen);
+
+	fsm.setInitialState(stGreen);
+	fsm.start();
+}
+
+
+void loop() {
+
+	// Read inputs
+	inCallButton = (digitalRead(BTN_CALL) == LOW);
+
+	// Run State Machine	(true is state changed)
+	if (fsm.execute()) {
+		Serial.print(F("Active state: "));
+		Serial.println(fsm.getActiveStateName());
+	}
+
+	// Set outputs
+	digitalWrite(RED_LED, outRed);
+	digitalWrite(GREEN_LED, outGreen);
+	digitalWrite(YELLOW_LED, outYellow);
+}
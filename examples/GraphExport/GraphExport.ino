@@ -0,0 +1,58 @@
+/*
+* Print the machine of PedestrianLight.ino as Graphviz DOT and Mermaid diagram,
+* and check it for design errors (unreachable states, states without exits,
+* shadowed transitions and cycles that can run without time elapsing).
+*
+* Paste the DOT output in https://dreampuf.github.io/GraphvizOnline
+* or the Mermaid output in https://mermaid.live
+*/
+
+#include <MachineGraph.h>
+
+// The Finite State Machine
+StateMachine fsm;
+
+// Input/Output State Machine interface
+bool inCallButton;
+bool outRed, outGreen, outYellow;
+
+void setupStateMachine() {
+	State *stCall = fsm.addState("Call semaphore", nullptr);
+	State *stGreen = fsm.addState("Green", nullptr);
+	State *stRed = fsm.addState("Red", nullptr);
+	State *stYellow = fsm.addState("Yellow", nullptr);
+
+	stGreen->addTransition(stCall, inCallButton);
+	stCall->addTransition(stYellow, 5000);
+	stYellow->addTransition(stRed, 5000);
+	stRed->addTransition(stGreen, 10000);
+
+	stRed->addAction(Action::Type::N, outRed);
+	stGreen->addAction(Action::Type::S, outGreen);
+	stYellow->addAction(Action::Type::R, outGreen);
+	stYellow->addAction(Action::Type::N, outYellow);
+
+	fsm.setInitialState(stGreen);
+}
+
+
+void setup() {
+	Serial.begin(115200);
+	setupStateMachine();
+
+	MachineGraph graph(fsm);
+	graph.printDot(Serial);
+	Serial.println();
+	graph.printMermaid(Serial);
+	Serial.println();
+
+	if (graph.analyze(Serial) == 0) {
+		Serial.println(F("No issues found"));
+	}
+	fsm.start();
+}
+
+
+void loop() {
+	fsm.execute();
+}
@@ -0,0 +1,99 @@
+/*
+* An automatic gate and a traffic light are two separate machines that coordinate with events, without shared variables:
+* the gate publishes GATE_OPEN when it has finished opening and GATE_CLOSING when it starts closing,
+* the light is green only while the gate is completely open.
+*/
+
+#include <AgileStateMachine.h>
+
+#define OPEN_BUTTON   2
+#define OUT_MOTOR_UP  10
+#define OUT_MOTOR_DN  11
+#define GREEN_LED     12
+#define RED_LED       13
+
+#define MOVE_TIME     5000
+#define OPEN_TIME     10000
+
+const AgileEvent GATE_OPEN(0);
+const AgileEvent GATE_CLOSING(1);
+
+EventBus bus;
+StateMachine gate, light;
+
+// Input/Output State Machine interface
+bool inOpen;
+bool outMotorUp, outMotorDown, outGreen, outRed;
+
+void printState() {
+	Serial.print(F("Light: "));
+	Serial.print(light.getActiveStateName());
+	if (light.getEvent() != nullptr) {
+		Serial.print(F(" (event "));
+		Serial.print(light.getEvent()->id);
+		Serial.print(F(")"));
+	}
+	Serial.println();
+}
+
+void setupGate() {
+	State *stClosed = gate.addState("CLOSED", nullptr);
+	State *stOpening = gate.addState("OPENING", nullptr);
+	State *stOpen = gate.addState("OPEN", nullptr);
+	State *stClosing = gate.addState("CLOSING", nullptr);
+
+	stClosed->addTransition(stOpening, inOpen);
+	stOpening->addTransition(stOpen, MOVE_TIME)->emit(bus, GATE_OPEN);
+	stOpen->addTransition(stClosing, OPEN_TIME);
+	stClosing->addTransition(stClosed, MOVE_TIME);
+	stClosing->emitOnEnter(bus, GATE_CLOSING);
+
+	stOpening->addAction(Action::Type::N, outMotorUp);
+	stClosing->addAction(Action::Type::N, outMotorDown);
+
+	gate.setInitialState(stClosed);
+	gate.start();
+}
+
+void setupLight() {
+	State *stRed = light.addState("RED", printState);
+	State *stGreen = light.addState("GREEN", printState);
+
+	stRed->addTransition(stGreen, GATE_OPEN);
+	stGreen->addTransition(stRed, GATE_CLOSING);
+
+	stRed->addAction(Action::Type::N, outRed);
+	stGreen->addAction(Action::Type::N, outGreen);
+
+	// Only GATE_OPEN and GATE_CLOSING are queued for the light (the events of its transitions)
+	bus.subscribe(light);
+	light.setInitialState(stRed);
+	light.start();
+}
+
+
+void setup() {
+	pinMode(OPEN_BUTTON, INPUT_PULLUP);
+	pinMode(OUT_MOTOR_UP, OUTPUT);
+	pinMode(OUT_MOTOR_DN, OUTPUT);
+	pinMode(GREEN_LED, OUTPUT);
+	pinMode(RED_LED, OUTPUT);
+
+	Serial.begin(115200);
+	Serial.println(F("Starting State Machines...\n"));
+	setupGate();
+	setupLight();
+}
+
+
+void loop() {
+	inOpen = digitalRead(OPEN_BUTTON) == LOW;
+
+	gate.execute();
+	light.execute();
+
+	digitalWrite(OUT_MOTOR_UP, outMotorUp);
+	digitalWrite(OUT_MOTOR_DN, outMotorDown);
+	digitalWrite(GREEN_LED, outGreen);
+	digitalWrite(RED_LED, outRed);
+}
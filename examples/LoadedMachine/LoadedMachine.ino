@@ -0,0 +1,97 @@
+/*
+* The machine of AutomaticGate.ino is not hard-coded, but loaded at runtime from a compact
+* binary description (machine.h), compiled from the readable AutomaticGate.fsm with
+*     python3 extras/machine_compiler.py AutomaticGate.fsm --name gateMachine -o machine.h
+*
+* The same buffer could be received from serial port or read from a file, so the logic
+* can be changed without reflashing. Names used in the description are bound to variables
+* and functions of the sketch with the bindings table.
+*/
+
+#include <MachineLoader.h>
+#include "machine.h"
+
+const byte SEC_FTC1 =  26;      // Safety photocell
+const byte BTN_START = 27;      // Gate open request
+const byte LED_OPEN =  14;
+const byte LED_CLOSE = 12;
+const byte LED_FLASHER  = 13;
+
+// Input/Output State Machine interface
+bool inStartButton, inSafetyFTC;
+bool outOpen, outClose, outFlashBlink;
+
+// The Finite State Machine
+StateMachine fsm;
+
+// This function will be executed before exit the current state
+void onLeave() {
+	Serial.print("Leaving state: ");
+	Serial.println(fsm.getActiveStateName());
+}
+
+// This function will be executed before enter next state
+void onEnter() {
+	Serial.print("Entered state: ");
+	Serial.println(fsm.getActiveStateName());
+}
+
+void onEnterWait() {
+	onEnter();
+	inSafetyFTC = false;
+}
+
+// Names used in the machine description
+const MachineBinding bindings[] = {
+	{"inStartButton", inStartButton},
+	{"inSafetyFTC", inSafetyFTC},
+	{"outOpen", outOpen},
+	{"outClose", outClose},
+	{"outFlashBlink", outFlashBlink},
+	{"onEnter", onEnter},
+	{"onLeave", onLeave},
+	{"onEnterWait", onEnterWait}
+};
+
+
+void setup() {
+	pinMode(SEC_FTC1, INPUT_PULLUP);
+	pinMode(BTN_START, INPUT_PULLUP);
+	pinMode(LED_OPEN, OUTPUT);
+	pinMode(LED_CLOSE, OUTPUT);
+	pinMode(LED_FLASHER, OUTPUT);
+
+	Serial.begin(115200);
+	Serial.println("Loading State Machine...\n");
+
+	MachineLoader loader(bindings);
+	MachineLoader::Error err = loader.load(fsm, gateMachine, sizeof(gateMachine));
+	if (err != MachineLoader::LOAD_OK) {
+		Serial.print("Error ");
+		Serial.print(err);
+		Serial.print(" at byte ");
+		Serial.println(loader.getPosition());
+		while (true) delay(1000);
+	}
+
+	fsm.start();
+	Serial.print("Active state: ");
+	Serial.println(fsm.getActiveStateName());
+}
+
+
+void loop() {
+	inStartButton = (digitalRead(BTN_START) == LOW);
+	inSafetyFTC = inSafetyFTC || ((outOpen || outClose) && digitalRead(SEC_FTC1) == LOW);
+
+	// Run State Machine (true is state changed)
+	if (fsm.execute()) {
+		Serial.print("Active state: ");
+		Serial.println(fsm.getActiveStateName());
+		Serial.println();
+	}
+
+	digitalWrite(LED_OPEN, outOpen);
+	digitalWrite(LED_CLOSE, outClose);
+	digitalWrite(LED_FLASHER, outFlashBlink);
+}
@@ -0,0 +1,22 @@
+// Generated by machine_compiler.py, do not edit
+const uint8_t gateMachine[] = {
+  0x41, 0x53, 0x4D, 0x01, 0x05, 0x00, 0x43, 0x6C, 0x6F, 0x73, 0x65, 0x64, 0x00, 0x00, 0x00, 0x6F,
+  0x6E, 0x45, 0x6E, 0x74, 0x65, 0x72, 0x00, 0x6F, 0x6E, 0x4C, 0x65, 0x61, 0x76, 0x65, 0x00, 0x00,
+  0x4F, 0x70, 0x65, 0x6E, 0x69, 0x6E, 0x67, 0x00, 0x00, 0x00, 0x6F, 0x6E, 0x45, 0x6E, 0x74, 0x65,
+  0x72, 0x00, 0x6F, 0x6E, 0x4C, 0x65, 0x61, 0x76, 0x65, 0x00, 0x00, 0x4F, 0x70, 0x65, 0x6E, 0x65,
+  0x64, 0x00, 0x00, 0x00, 0x6F, 0x6E, 0x45, 0x6E, 0x74, 0x65, 0x72, 0x00, 0x6F, 0x6E, 0x4C, 0x65,
+  0x61, 0x76, 0x65, 0x00, 0x00, 0x43, 0x6C, 0x6F, 0x73, 0x69, 0x6E, 0x67, 0x00, 0x00, 0x00, 0x6F,
+  0x6E, 0x45, 0x6E, 0x74, 0x65, 0x72, 0x00, 0x6F, 0x6E, 0x4C, 0x65, 0x61, 0x76, 0x65, 0x00, 0x00,
+  0x53, 0x74, 0x6F, 0x70, 0x20, 0x26, 0x20, 0x57, 0x61, 0x69, 0x74, 0x00, 0x00, 0x00, 0x6F, 0x6E,
+  0x45, 0x6E, 0x74, 0x65, 0x72, 0x57, 0x61, 0x69, 0x74, 0x00, 0x6F, 0x6E, 0x4C, 0x65, 0x61, 0x76,
+  0x65, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x69, 0x6E, 0x53, 0x74, 0x61, 0x72, 0x74, 0x42, 0x75,
+  0x74, 0x74, 0x6F, 0x6E, 0x00, 0x01, 0x02, 0x02, 0x90, 0x4E, 0x02, 0x03, 0x02, 0x90, 0x4E, 0x03,
+  0x00, 0x02, 0x90, 0x4E, 0x03, 0x04, 0x00, 0x69, 0x6E, 0x53, 0x61, 0x66, 0x65, 0x74, 0x79, 0x46,
+  0x54, 0x43, 0x00, 0x04, 0x01, 0x02, 0x88, 0x27, 0x07, 0x00, 0x02, 0x6F, 0x75, 0x74, 0x46, 0x6C,
+  0x61, 0x73, 0x68, 0x42, 0x6C, 0x69, 0x6E, 0x6B, 0x00, 0x00, 0x01, 0x01, 0x6F, 0x75, 0x74, 0x46,
+  0x6C, 0x61, 0x73, 0x68, 0x42, 0x6C, 0x69, 0x6E, 0x6B, 0x00, 0x00, 0x01, 0x04, 0x6F, 0x75, 0x74,
+  0x4F, 0x70, 0x65, 0x6E, 0x00, 0xD0, 0x0F, 0x03, 0x01, 0x6F, 0x75, 0x74, 0x46, 0x6C, 0x61, 0x73,
+  0x68, 0x42, 0x6C, 0x69, 0x6E, 0x6B, 0x00, 0x00, 0x03, 0x04, 0x6F, 0x75, 0x74, 0x43, 0x6C, 0x6F,
+  0x73, 0x65, 0x00, 0xD0, 0x0F, 0x04, 0x02, 0x6F, 0x75, 0x74, 0x4F, 0x70, 0x65, 0x6E, 0x00, 0x00,
+  0x04, 0x02, 0x6F, 0x75, 0x74, 0x43, 0x6C, 0x6F, 0x73, 0x65, 0x00, 0x00,
+};
@@ -0,0 +1,110 @@
+/*
+* Same as PedestrianLight.ino, but the whole machine definition (states, transitions,
+* actions and state names) is stored in flash memory with PROGMEM.
+* Only the runtime of the machine (active state, enter time and flags) uses SRAM.
+*/
+
+#include <FlashStateMachine.h>
+
+const byte BTN_CALL   = 2;
+const byte GREEN_LED  = 12;
+const byte YELLOW_LED = 11;
+const byte RED_LED    = 10;
+
+// Pedestrian traffic light -> green ligth ON until button pressed
+const uint32_t YELLOW_TIME = 5000;
+const uint32_t RED_TIME    = 10000;
+const uint32_t CALL_DELAY  = 5000;
+
+// Input/Output State Machine interface
+bool inCallButton;
+bool outRed, outGreen, outYellow;
+
+// States are identified by their index in the states table
+enum { CALL, GREEN, RED, YELLOW };
+
+const char nameCall[] PROGMEM   = "Call semaphore";
+const char nameGreen[] PROGMEM  = "Green";
+const char nameRed[] PROGMEM    = "Red";
+const char nameYellow[] PROGMEM = "Yellow";
+
+void onEnter();
+void onExit();
+
+// name, min time, max time, onEnter cb, onExit cb, onRun cb
+const FlashState states[] PROGMEM = {
+	{nameCall,   0, 0, onEnter, onExit, nullptr},
+	{nameGreen,  0, 0, onEnter, onExit, nullptr},
+	{nameRed,    0, 0, onEnter, onExit, nullptr},
+	{nameYellow, 0, 0, onEnter, onExit, nullptr}
+};
+
+// from, to, bool trigger, callback trigger, timeout (sorted by "from" state)
+const FlashTransition transitions[] PROGMEM = {
+	{CALL,   YELLOW, nullptr,       nullptr, CALL_DELAY},
+	{GREEN,  CALL,   &inCallButton, nullptr, 0},
+	{RED,    GREEN,  nullptr,       nullptr, RED_TIME},
+	{YELLOW, RED,    nullptr,       nullptr, YELLOW_TIME}
+};
+
+// state, action type, target, time (sorted by state)
+const FlashAction actions[] PROGMEM = {
+	{GREEN,  Action::Type::S, &outGreen,  0},	// S -> SET green led on
+	{RED,    Action::Type::N, &outRed,    0},	// N -> while state is active red led is ON
+	{YELLOW, Action::Type::R, &outGreen,  0},	// R -> RESET the green led
+	{YELLOW, Action::Type::N, &outYellow, 0}	// N -> while state is active yellow led is ON
+};
+
+// The Finite State Machine
+FlashStateMachine fsm(states, transitions, actions);
+
+
+/////////// STATE MACHINE FUNCTIONS //////////////////
+
+// This function will be executed before exit the current state
+void onEnter() {
+	Serial.print(F("Enter on state: "));
+	Serial.println(fsm.getActiveStateName_P());
+}
+// Define "on leaving" callback function (the same for all "light"  states)
+void onExit() {
+	Serial.print(F("Exit from state: "));
+	Serial.println(fsm.getActiveStateName_P());
+}
+
+
+void setup() {
+	pinMode(BTN_CALL, INPUT_PULLUP);
+	pinMode(GREEN_LED, OUTPUT);
+	pinMode(YELLOW_LED, OUTPUT);
+	pinMode(RED_LED, OUTPUT);
+
+	Serial.begin(115200);
+	Serial.println(F("Starting State Machine..."));
+
+	/* Set initial state and start the Machine State */
+	fsm.setInitialState(GREEN);
+	fsm.start();
+	Serial.print(F("Active state: "));
+	Serial.println(fsm.getActiveStateName_P());
+	Serial.println();
+}
+
+
+void loop() {
+
+	// Read inputs
+	inCallButton = (digitalRead(BTN_CALL) == LOW);
+
+	// Run State Machine	(true is state changed)
+	if (fsm.execute()) {
+		Serial.print(F("Active state: "));
+		Serial.println(fsm.getActiveStateName_P());
+		Serial.println();
+	}
+
+	// Set outputs
+	digitalWrite(RED_LED, outRed);
+	digitalWrite(GREEN_LED, outGreen);
+	digitalWrite(YELLOW_LED, outYellow);
+}
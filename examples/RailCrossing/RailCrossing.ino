@@ -16,15 +16,17 @@
 #define CLOSE_POSITION  0
 #define OPEN_POSITION   90
 
-// Handle the gate position
+// Handle the gate position (moved slowly by a ramp action: 1 degree every 10 ms)
 Servo theGate;
-uint16_t servoPos = OPEN_POSITION ;
+int16_t servoPos = OPEN_POSITION;
+#define SERVO_RATE 100
 
 // The Finite State Machine
 StateMachine fsm;
 
-// Input State Machine interface
+// Input/Output State Machine interface
 bool inTrainArrive, inTrainGone;
+bool outLightBell;
 
 // The finite state
 State* stGateOpen;    // The rail crossing gate is opened (free entry)
@@ -33,22 +35,6 @@ State* stMoveUp;      // The rail crossing gate is moving up (free)
 State* stMoveDown;    // The rail crossing gate is moving down (stop)
 State* stWaitTrain;   // Wait if another train is passing before move up the gate
 
-void runServoSlow() {
-  static uint8_t actualPos;
-  static uint32_t stepTime;
-
-  if (millis() - stepTime > 10) {
-    stepTime = millis();
-    if (actualPos < servoPos)
-      actualPos++;
-    if (actualPos > servoPos)
-      actualPos--;
-
-    theGate.write(actualPos);
-  }
-}
-
-
 /////////// STATE MACHINE FUNCTIONS //////////////////
 
 // This function will be executed before enter next state
@@ -57,17 +43,14 @@ void onEnter() {
     Serial.println(F("The GATE is actually close"));
   }
   else if (fsm.getCurrentState() == stMoveUp ) {
-    servoPos = OPEN_POSITION;
     Serial.println(F("The GATE is going to be opened"));
   }
   else if (fsm.getCurrentState() == stGateOpen ) {
     digitalWrite(STOP_PASS, LOW);
     digitalWrite(FREE_PASS, HIGH);
-    digitalWrite(OUT_LIGHT_BELL, LOW);
     Serial.println(F("The GATE is actually open"));
   }
   else if (fsm.getCurrentState() == stMoveDown ) {
-    servoPos = CLOSE_POSITION;
     digitalWrite(STOP_PASS, HIGH);
     digitalWrite(FREE_PASS, LOW);
     Serial.println(F("A new train is coming! Start closing the GATE."));
@@ -79,28 +62,15 @@ void onEnter() {
   }
 }
 
-// Blink and play the bell while gate is moving or closed
-void bewareOfTrains() {
-  static bool level = LOW;
-  static uint32_t bTime;
-
-  if (millis() - bTime >= BLINK_TIME ) {
-    level = !level;
-    bTime = millis();
-    digitalWrite(OUT_LIGHT_BELL, level);
-  }
-}
-
-
 // Definition and modeling of the finite state machine
 void setupStateMachine() {
   /* Create states and assign name and callback functions */
   //                           name, minTime, onEnter cb, onRun cb, onExit cb
   stGateOpen   = fsm.addState("Gate OPEN", onEnter);
-  stGateClose  = fsm.addState("Gate CLOSE", onEnter, nullptr, bewareOfTrains);
-  stMoveDown   = fsm.addState("Move gate DOWN", onEnter, nullptr, bewareOfTrains);
-  stMoveUp     = fsm.addState("Move gate UP", onEnter, nullptr, bewareOfTrains);
-  stWaitTrain  = fsm.addState("Wait Train", onEnter, nullptr, bewareOfTrains);
+  stGateClose  = fsm.addState("Gate CLOSE", onEnter);
+  stMoveDown   = fsm.addState("Move gate DOWN", onEnter);
+  stMoveUp     = fsm.addState("Move gate UP", onEnter);
+  stWaitTrain  = fsm.addState("Wait Train", onEnter);
 
   stGateOpen->addTransition(stMoveDown, inTrainArrive);
   stGateClose->addTransition(stWaitTrain, inTrainGone);
@@ -108,6 +78,16 @@ void setupStateMachine() {
   stMoveUp->addTransition(stGateOpen, MOVE_TIME);
   stWaitTrain->addTransition(stMoveUp, WAIT_FREE_TIME);
 
+  // Blink and play the bell while gate is moving or closed (P -> pulse with period of 2 * BLINK_TIME)
+  stGateClose->addAction(Action::Type::P, outLightBell, 2 * BLINK_TIME);
+  stMoveDown->addAction(Action::Type::P, outLightBell, 2 * BLINK_TIME);
+  stMoveUp->addAction(Action::Type::P, outLightBell, 2 * BLINK_TIME);
+  stWaitTrain->addAction(Action::Type::P, outLightBell, 2 * BLINK_TIME);
+
+  // Smooth move of the gate to target position
+  stMoveDown->addRamp(servoPos, CLOSE_POSITION, SERVO_RATE);
+  stMoveUp->addRamp(servoPos, OPEN_POSITION, SERVO_RATE);
+
   /* Set initial state and start the Machine State */
   fsm.setInitialState(stGateOpen);
   fsm.start();
@@ -134,9 +114,6 @@ void setup() {
 
 
 void loop() {
-  // Smoot run servo to taret position
-  runServoSlow();
-
   // Update the input variables according to the signal inputs
   inTrainGone = digitalRead(SIG_TRAIN_OUT) == LOW;
   inTrainArrive = digitalRead(SIG_TRAIN_IN) == LOW;
@@ -154,8 +131,10 @@ void loop() {
   }
 
   // Run State Machine
-  // Outputs will be handled inside onEnter callback function
+  // Pass outputs are handled inside onEnter callback function
   fsm.execute();
+  digitalWrite(OUT_LIGHT_BELL, outLightBell);
+  theGate.write(servoPos);
 }
 
 
@@ -0,0 +1,101 @@
+/*
+* A start/stop motor executed every 1 ms, a blinking led every 10 ms and a slow monitor every 100 ms,
+* released by an Executive with fixed periods. Every 5 seconds the monitor prints for each group
+* the number of runs, the releases lost (overruns), the max jitter and the longest run.
+*/
+
+#include <Executive.h>
+
+#define START_BUTTON    4
+#define STOP_BUTTON     5
+#define OUT_LED         12
+#define OUT_MOTOR       13
+
+StateMachine motor, blinker, monitor;
+StateMachine *const fastGroup[] = {&motor};
+StateMachine *const midGroup[] = {&blinker};
+StateMachine *const slowGroup[] = {&monitor};
+Executive executive;
+
+// Input/Output State Machine interface
+bool inStart, inStop;
+bool outMotor, outLed;
+
+void setupMotor() {
+	State *stIdle = motor.addState("IDLE", nullptr);
+	State *stRun = motor.addState("RUN", 5000, nullptr);
+	State *stStop = motor.addState("STOP", 1000, nullptr);
+
+	stIdle->addTransition(stRun, inStart);
+	stRun->addTransition(stStop, inStop);
+	stStop->addTransition(stIdle, 1000);
+
+	stRun->addAction(Action::Type::S, outMotor);
+	stStop->addAction(Action::Type::R, outMotor);
+
+	motor.setInitialState(stIdle);
+	motor.start();
+}
+
+void setupBlinker() {
+	State *stBlink = blinker.addState("BLINK", nullptr);
+	stBlink->addAction(Action::Type::P, outLed, 500);
+	blinker.setInitialState(stBlink);
+	blinker.start();
+}
+
+void printStats() {
+	for (uint8_t i = 0; i < executive.getGroupsNumber(); i++) {
+		const RateGroup *group = executive.getGroup(i);
+		Serial.print(group->period / 1000);
+		Serial.print(F(" ms group: runs "));
+		Serial.print(group->runs);
+		Serial.print(F(", overruns "));
+		Serial.print(group->overruns);
+		Serial.print(F(", max jitter "));
+		Serial.print(group->maxJitter);
+		Serial.print(F(" us, longest run "));
+		Serial.print(group->maxDuration);
+		Serial.println(F(" us"));
+	}
+	executive.resetStats();
+}
+
+void setupMonitor() {
+	State *stWait = monitor.addState("WAIT", nullptr);
+	State *stReport = monitor.addState("REPORT", printStats);
+	stWait->addTransition(stReport, 5000);
+	stReport->addTransition(stWait, 1);
+	monitor.setInitialState(stWait);
+	monitor.start();
+}
+
+
+void setup() {
+	pinMode(START_BUTTON, INPUT_PULLUP);
+	pinMode(STOP_BUTTON, INPUT_PULLUP);
+	pinMode(OUT_LED, OUTPUT);
+	pinMode(OUT_MOTOR, OUTPUT);
+
+	Serial.begin(115200);
+	setupMotor();
+	setupBlinker();
+	setupMonitor();
+
+	executive.addGroup(1000, fastGroup);     // Periods in microseconds
+	executive.addGroup(10000, midGroup);
+	executive.addGroup(100000, slowGroup);
+	executive.start();
+}
+
+
+void loop() {
+	inStart = (digitalRead(START_BUTTON) == LOW) && !outMotor;
+	inStop = (digitalRead(STOP_BUTTON) == LOW) && outMotor;
+
+	// Runs only the groups released since last call
+	executive.poll();
+
+	digitalWrite(OUT_MOTOR, outMotor);
+	digitalWrite(OUT_LED, outLed);
+}
@@ -0,0 +1,72 @@
+/*
+* Replay a recorded trace of inputs on the machine of PedestrianLight.ino with a virtual clock.
+* The simulation jumps from an event to the next deadline of the machine, so two hours
+* of traffic light are checked in a few milliseconds and the log is always the same.
+*
+* Each line of the log is "time state": save it and compare with diff after a change of the machine.
+*/
+
+#include <Simulator.h>
+
+// The Finite State Machine
+StateMachine fsm;
+
+// Input/Output State Machine interface
+bool inCallButton;
+bool outRed, outGreen, outYellow;
+
+// Recorded presses of the call button (time in milliseconds, input, value)
+const SimEvent trace[] = {
+	{1000, &inCallButton, true},
+	{1200, &inCallButton, false},
+	{3600000UL, &inCallButton, true},
+	{3600050UL, &inCallButton, false},
+	{3612000UL, &inCallButton, true},
+	{3612100UL, &inCallButton, false}
+};
+
+void setupStateMachine() {
+	State *stCall = fsm.addState("Call semaphore", nullptr);
+	State *stGreen = fsm.addState("Green", nullptr);
+	State *stRed = fsm.addState("Red", nullptr);
+	State *stYellow = fsm.addState("Yellow", nullptr);
+
+	stGreen->addTransition(stCall, inCallButton);
+	stCall->addTransition(stYellow, 5000);
+	stYellow->addTransition(stRed, 5000);
+	stRed->addTransition(stGreen, 10000);
+
+	stRed->addAction(Action::Type::N, outRed);
+	stGreen->addAction(Action::Type::S, outGreen);
+	stYellow->addAction(Action::Type::R, outGreen);
+	stYellow->addAction(Action::Type::N, outYellow);
+
+	fsm.setInitialState(stGreen);
+}
+
+
+void setup() {
+	Serial.begin(115200);
+	setupStateMachine();
+
+	Simulator sim(fsm);
+	sim.setTrace(trace);
+	sim.setLog(Serial);
+
+	uint32_t t0 = millis();
+	uint32_t transitions = sim.run(7200000UL);
+	Serial.print(transitions);
+	Serial.print(F(" transitions, "));
+	Serial.print(sim.getSteps());
+	Serial.print(F(" steps in "));
+	Serial.print(millis() - t0);
+	Serial.println(F(" ms"));
+
+	// Back to real time
+	fsm.start();
+}
+
+
+void loop() {
+	fsm.execute();
+}
@@ -0,0 +1,91 @@
+/*
+* Filling of a tank with states written as classes (StateImpl):
+* each state keeps its own data and defines only the handlers it needs, guards are member functions.
+* The pump runs until the high level sensor is reached, or until the filling takes too long (alarm).
+*/
+
+#include <StateImpl.h>
+
+#define LEVEL_LOW     4
+#define LEVEL_HIGH    5
+#define RESET_BUTTON  6
+#define OUT_PUMP      12
+#define OUT_ALARM     13
+
+StateMachine fsm;
+
+// Input/Output State Machine interface
+bool inReset;
+bool outPump, outAlarm;
+
+class Waiting : public StateImpl<Waiting>
+{
+public:
+	Waiting() : StateImpl("WAITING", 2000) {}     // Rest time of the pump between fillings
+
+	bool isEmpty() { return digitalRead(LEVEL_LOW) == LOW; }
+};
+
+class Filling : public StateImpl<Filling>
+{
+public:
+	Filling() : StateImpl("FILLING") {}
+
+	uint16_t fillings = 0;
+
+	void onEnter() {
+		fillings++;
+		Serial.print(F("Filling n. "));
+		Serial.println(fillings);
+	}
+
+	void onExit() {
+		Serial.print(F("Filled in "));
+		Serial.print(millis() - getEnterTime());
+		Serial.println(F(" ms"));
+	}
+
+	bool isFull() { return digitalRead(LEVEL_HIGH) == LOW; }
+};
+
+Waiting stWaiting;
+Filling stFilling;
+State stAlarm("ALARM", nullptr);
+
+
+void setup() {
+	pinMode(LEVEL_LOW, INPUT_PULLUP);
+	pinMode(LEVEL_HIGH, INPUT_PULLUP);
+	pinMode(RESET_BUTTON, INPUT_PULLUP);
+	pinMode(OUT_PUMP, OUTPUT);
+	pinMode(OUT_ALARM, OUTPUT);
+
+	Serial.begin(115200);
+	Serial.println(F("Starting State Machine...\n"));
+
+	fsm.addState(stWaiting);
+	fsm.addState(stFilling);
+	fsm.addState(stAlarm);
+
+	stWaiting.addTransition<&Waiting::isEmpty>(&stFilling);
+	stFilling.addTransition<&Filling::isFull>(&stWaiting);
+	stFilling.setStateMaxTime(30000, &stAlarm);
+	stAlarm.addTransition(&stWaiting, inReset);
+
+	stFilling.addAction(Action::Type::N, outPump);
+	stAlarm.addAction(Action::Type::N, outAlarm);
+
+	fsm.setInitialState(stWaiting);
+	fsm.start();
+}
+
+
+void loop() {
+	inReset = digitalRead(RESET_BUTTON) == LOW;
+
+	// Handlers of the classes listed are called directly by the engine
+	fsm.execute<Waiting, Filling>();
+
+	digitalWrite(OUT_PUMP, outPump);
+	digitalWrite(OUT_ALARM, outAlarm);
+}
@@ -0,0 +1,105 @@
+/*
+* Same machine of StartStopMotor.ino, but the runtime of the machine is saved in EEPROM
+* on each state change: after a reset the machine resumes from the last active state
+* (with elapsed time and actions) instead of restarting from initial state.
+*
+* The snapshot is a small versioned binary blob, so it can be stored as well in RTC memory or NVS.
+*/
+
+#include <EEPROM.h>
+#include "AgileStateMachine.h"
+
+#define START_BUTTON  4
+#define STOP_BUTTON   5
+#define OUT_MOTOR     13
+
+#define SNAPSHOT_ADDRESS  0
+#define SNAPSHOT_MAX_SIZE 32
+
+// Create new Finite State Machine
+StateMachine myFSM;
+
+// Input/Output State Machine interface
+bool inStart, inStop;
+bool outMotor;
+
+// Store the runtime of machine in EEPROM (first byte is the length of snapshot)
+void saveMachine() {
+  uint8_t buffer[SNAPSHOT_MAX_SIZE];
+  size_t len = myFSM.saveSnapshot(buffer, sizeof(buffer));
+  EEPROM.write(SNAPSHOT_ADDRESS, len);
+  for (size_t i = 0; i < len; i++)
+    EEPROM.write(SNAPSHOT_ADDRESS + 1 + i, buffer[i]);
+#if defined(ESP32) || defined(ESP8266)
+  EEPROM.commit();
+#endif
+}
+
+// Restore the runtime of machine from EEPROM (false if there is no valid snapshot)
+bool restoreMachine() {
+  uint8_t buffer[SNAPSHOT_MAX_SIZE];
+  size_t len = EEPROM.read(SNAPSHOT_ADDRESS);
+  if (len > sizeof(buffer))
+    return false;
+  for (size_t i = 0; i < len; i++)
+    buffer[i] = EEPROM.read(SNAPSHOT_ADDRESS + 1 + i);
+  return myFSM.restoreSnapshot(buffer, len);
+}
+
+
+// Definition of the model of the finite state machine and start execution
+void setupStateMachine() {
+  // Create some states and assign name, min time and callback functions
+  State* stIdle = myFSM.addState("IDLE", nullptr);
+  State* stRun  = myFSM.addState("RUN", 5000, nullptr, nullptr, nullptr);
+  State* stStop = myFSM.addState("STOP", 1000, nullptr, nullptr, nullptr);
+
+  // Add transitions to target state and trigger condition
+  stIdle->addTransition(stRun, inStart);
+  stRun->addTransition(stStop, inStop);
+  stStop->addTransition(stIdle, 1000);  // Wait some time to be shure motor is stopped
+
+  // Add actions to state
+  stRun->addAction(Action::Type::S, outMotor);
+  stStop->addAction(Action::Type::R, outMotor);
+
+  // Start the Machine State
+  myFSM.setInitialState(stIdle);
+  myFSM.start();
+}
+
+
+void setup() {
+  pinMode(START_BUTTON, INPUT_PULLUP);
+  pinMode(STOP_BUTTON, INPUT_PULLUP);
+  pinMode(OUT_MOTOR, OUTPUT);
+
+  Serial.begin(115200);
+#if defined(ESP32) || defined(ESP8266)
+  EEPROM.begin(SNAPSHOT_MAX_SIZE + 1);
+#endif
+  setupStateMachine();
+
+  // Resume the machine from last saved snapshot (if valid)
+  if (restoreMachine())
+    Serial.print(F("\nMachine restored. Active state: "));
+  else
+    Serial.print(F("\nMachine started. Active state: "));
+  Serial.println(myFSM.getActiveStateName());
+  digitalWrite(OUT_MOTOR, outMotor);
+}
+
+
+void loop() {
+  inStart = (digitalRead(START_BUTTON) == LOW) && !outMotor;
+  inStop = (digitalRead(STOP_BUTTON) == LOW) && outMotor;
+
+  // Update State Machine (true is state changed) and save the new runtime
+  if (myFSM.execute()) {
+    Serial.print(F("Active state: "));
+    Serial.println(myFSM.getActiveStateName());
+    saveMachine();
+  }
+
+  digitalWrite(OUT_MOTOR, outMotor);
+}
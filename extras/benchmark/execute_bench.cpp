@@ -0,0 +1,91 @@
+/*
+* Host benchmark of StateMachine::execute(): machines shaped as the PedestrianLight example (variables, timeouts,
+* callbacks, S/R/L/D actions) executed every millisecond of virtual time. Prints the mean cost of one execute()
+* in CPU cycles (x86 time stamp counter) and nanoseconds: median of some rounds, with the min and max of the rounds.
+* Build and compare the configurations with run.sh (pinned to one core).
+*/
+#include <algorithm>
+#include <chrono>
+#include "AgileStateMachine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+uint32_t hostMillis = 0;
+
+static const uint8_t MACHINES = 64;
+static const uint32_t TICKS = 50000;
+static const uint8_t ROUNDS = 15;
+
+struct Light
+{
+	StateMachine fsm;
+	bool inButton = false;
+	bool outRed = false, outYellow = false, outGreen = false, outWalk = false;
+};
+
+static Light lights[MACHINES];
+static uint16_t crossings = 0;
+
+static bool canCross() { return (crossings & 1) == 0; }
+static void onCrossing() { crossings++; }
+
+static void setupLight(Light &light, uint32_t offset) {
+	StateMachine &fsm = light.fsm;
+	State *stGreen = fsm.addState("Green", 1000 + offset, nullptr);
+	State *stYellow = fsm.addState("Yellow", 200, nullptr);
+	State *stRed = fsm.addState("Red", onCrossing);
+	State *stWait = fsm.addState("Wait", 500, nullptr);
+
+	stGreen->addTransition(stYellow, light.inButton);
+	stGreen->addTransition(stYellow, 20000);
+	stYellow->addTransition(stRed, 2000);
+	stRed->addTransition(stWait, 8000);
+	stWait->addTransition(stGreen, canCross);
+	stWait->addTransition(stGreen, 3000);
+
+	stGreen->addAction(Action::Type::S, light.outGreen);
+	stGreen->addAction(Action::Type::R, light.outRed);
+	stYellow->addAction(Action::Type::N, light.outYellow);
+	stYellow->addAction(Action::Type::R, light.outGreen);
+	stRed->addAction(Action::Type::S, light.outRed);
+	stRed->addAction(Action::Type::L, light.outWalk, 6000);
+	stWait->addAction(Action::Type::D, light.outYellow, 200);
+
+	fsm.setInitialState(stGreen);
+	fsm.start();
+}
+
+int main() {
+	for (uint8_t i = 0; i < MACHINES; i++) {
+		setupLight(lights[i], i * 37);
+	}
+
+	uint32_t changes = 0;
+	double roundsCycles[ROUNDS], roundsNs[ROUNDS];
+	for (uint8_t round = 0; round < ROUNDS; round++) {
+		const auto start = std::chrono::steady_clock::now();
+		const uint64_t startCycles = cycles();
+		for (uint32_t t = 0; t < TICKS; t++) {
+			hostMillis++;
+			for (uint8_t i = 0; i < MACHINES; i++) {
+				lights[i].inButton = ((hostMillis + i * 131) % 9000) == 0;
+				changes += lights[i].fsm.execute();
+			}
+		}
+		const double calls = (double)TICKS * MACHINES;
+		roundsCycles[round] = (cycles() - startCycles) / calls;
+		roundsNs[round] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+	}
+
+	std::sort(roundsCycles, roundsCycles + ROUNDS);
+	std::sort(roundsNs, roundsNs + ROUNDS);
+	printf("%.1f cycles (%.1f..%.1f), %.2f ns (%.2f..%.2f) per execute(), median (min..max) of %u rounds, %lu state changes\n",
+		roundsCycles[ROUNDS / 2], roundsCycles[0], roundsCycles[ROUNDS - 1],
+		roundsNs[ROUNDS / 2], roundsNs[0], roundsNs[ROUNDS - 1], ROUNDS, (unsigned long)changes);
+	return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Cost of execute() with the engine split in translation units and with AGILE_SM_HEADER_ONLY, both without LTO.
+# Pinned to one core when taskset is available (CPU to change it, default 0).
+#
+# usage: extras/benchmark/run.sh        (CXX and OPT to change compiler and optimization, default g++ -Os as Arduino)
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/../../src"
+CXX=${CXX:-g++}
+OPT=${OPT:--Os}
+OUT=$(mktemp -d)
+PIN=""
+if command -v taskset > /dev/null; then
+	PIN="taskset -c ${CPU:-0}"
+fi
+
+build() {
+	$CXX -std=c++17 $OPT -fno-lto -I"$DIR/../host" -I"$SRC" "$@" "$SRC"/*.cpp "$DIR/execute_bench.cpp" -o "$OUT/bench" || exit 1
+}
+
+build
+printf "split:       "
+$PIN "$OUT/bench"
+
+build -DAGILE_SM_HEADER_ONLY
+printf "header-only: "
+$PIN "$OUT/bench"
+
+rm -rf "$OUT"
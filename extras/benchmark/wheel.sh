@@ -0,0 +1,19 @@
+#!/bin/sh
+# Cost of a tick of TimerWheel::run() against polling execute() of all the machines, with 1000 and 100000 armed timers.
+# Pinned to one core when taskset is available.
+#
+# usage: extras/benchmark/wheel.sh      (CXX and OPT to change compiler and optimization, default g++ -O2)
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/../../src"
+CXX=${CXX:-g++}
+OPT=${OPT:--O2}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+$CXX -std=c++17 $OPT -I"$DIR/../host" -I"$SRC" "$SRC"/*.cpp "$DIR/wheel_bench.cpp" -o "$OUT/bench" || exit 1
+if command -v taskset > /dev/null; then
+	taskset -c 0 "$OUT/bench"
+else
+	"$OUT/bench"
+fi
@@ -0,0 +1,84 @@
+/*
+* Host benchmark of TimerWheel: machines with two states linked by timed transitions (deadlines spread over some seconds),
+* run for some seconds of virtual time with TimerWheel::run() and by polling execute() of all the machines at every tick.
+* Prints the cost of one tick in nanoseconds (median of some rounds, with min and max) for 1000 and 100000 armed timers.
+* Build and run with wheel.sh.
+*/
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "TimerWheel.h"
+
+uint32_t hostMillis = 0;
+
+static const uint8_t ROUNDS = 7;
+static const uint32_t SPREAD = 5000;    // Deadlines between 1 and 6 seconds
+
+struct Result
+{
+	double median, min, max;
+};
+
+static Result summary(std::vector<double> &samples) {
+	std::sort(samples.begin(), samples.end());
+	return {samples[samples.size() / 2], samples.front(), samples.back()};
+}
+
+static void setup(StateMachine &fsm, uint32_t index) {
+	State *stA = fsm.addState("A", nullptr);
+	State *stB = fsm.addState("B", nullptr);
+	stA->addTransition(stB, 1000 + (index * 7919) % SPREAD);
+	stB->addTransition(stA, 1000 + (index * 104729) % SPREAD);
+	fsm.setInitialState(stA);
+	fsm.start();
+}
+
+// Nanoseconds of each tick (one millisecond of virtual time), one sample for each round
+template <typename F>
+static Result measure(uint32_t ticks, F tick) {
+	std::vector<double> samples;
+	for (uint8_t round = 0; round < ROUNDS; round++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t t = 0; t < ticks; t++) {
+			hostMillis++;
+			tick();
+		}
+		samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ticks);
+	}
+	return summary(samples);
+}
+
+static void bench(uint32_t count) {
+	TimerWheel wheel;
+	std::vector<StateMachine> machines(count);
+	for (uint32_t i = 0; i < count; i++) {
+		setup(machines[i], i);
+		wheel.add(machines[i]);
+	}
+
+	uint64_t fired = 0;
+	const uint32_t ticks = 2000;
+	const Result wheelTick = measure(ticks, [&]() { fired += wheel.run(); });
+	printf("%6u armed, wheel: %10.1f ns per tick (min %.1f, max %.1f), %.2f machines executed per tick\n",
+		(unsigned)wheel.getArmed(), wheelTick.median, wheelTick.min, wheelTick.max, (double)fired / (ticks * ROUNDS));
+
+	// Same machines without the wheel
+	std::vector<StateMachine> polled(count);
+	for (uint32_t i = 0; i < count; i++) {
+		setup(polled[i], i);
+	}
+	const uint32_t pollTicks = count > 10000 ? 50 : 2000;
+	const Result pollTick = measure(pollTicks, [&]() {
+		for (StateMachine &fsm : polled) {
+			fsm.execute();
+		}
+	});
+	printf("%6u armed, poll:  %10.1f ns per tick (min %.1f, max %.1f)\n", (unsigned)count, pollTick.median, pollTick.min, pollTick.max);
+}
+
+int main() {
+	hostMillis = 1;
+	bench(1000);
+	bench(100000);
+	return 0;
+}
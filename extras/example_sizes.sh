@@ -0,0 +1,79 @@
+#!/bin/sh
+# Flash and RAM used by the bundled examples, with and without state names (AGILE_SM_NO_NAMES).
+# Needs arduino-cli with the core of the board installed. With --host the examples are built with g++ -Os
+# and the Arduino shim of extras/host instead: code (.text) and constant data (.rodata) of the host program,
+# and RAM of the sketch (.data and .bss more than an empty sketch, plus the heap allocated by setup()),
+# useful to compare configurations and examples when no board toolchain is available (not the size on a board).
+#
+# usage: extras/example_sizes.sh [fqbn]     (default arduino:avr:uno)
+#        extras/example_sizes.sh --host     (CXX to change compiler)
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=$(mktemp -d)
+
+if [ "$1" = "--host" ]; then
+	HOST=1
+	CXX=${CXX:-g++}
+
+	# Heap allocated by setup() is printed on stderr
+	cat > "$BUILD/main.cpp" << 'EOF'
+#include "Arduino.h"
+uint32_t hostMillis = 0;
+Print Serial;
+static size_t heap = 0;
+void *operator new(size_t size) { heap += size; return malloc(size > 0 ? size : 1); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void setup();
+void loop();
+int main() { setup(); fprintf(stderr, "%u\n", (unsigned)heap); loop(); return 0; }
+EOF
+	mkdir "$BUILD/Empty"
+	printf 'void setup() {}\nvoid loop() {}\n' > "$BUILD/Empty/Empty.ino"
+
+	# .text, .rodata and RAM (.data, .bss and heap) of the program
+	sizes() {
+		$CXX -std=c++20 -Os -w -ffunction-sections -fdata-sections -Wl,--gc-sections $2 -I"$ROOT/extras/host" -I"$ROOT/src" -I"$1" \
+			-include Arduino.h -x c++ "$1/$(basename "$1").ino" -x none "$ROOT"/src/*.cpp "$BUILD/main.cpp" -o "$BUILD/sketch" 2>/dev/null &&
+			heap=$(timeout 10 "$BUILD/sketch" 2>&1 > /dev/null | tail -n 1) &&
+			size -A "$BUILD/sketch" | awk -v heap="$heap" -v empty="${EMPTY_RAM:-0}" '
+				$1 == ".text" { text = $2 } $1 == ".rodata" { data = $2 } $1 == ".data" || $1 == ".bss" { ram += $2 }
+				END { printf "%s %s %s", text, data, ram + heap - empty }'
+	}
+
+	set -- $(sizes "$BUILD/Empty" "")
+	EMPTY_RAM=$3
+	printf "%-20s %8s %8s %8s %8s %8s %8s\n" "example" ".text" ".rodata" "ram" ".text*" ".rodata*" "ram*"
+else
+	FQBN=${1:-arduino:avr:uno}
+
+	# "Sketch uses N bytes" and "Global variables use M bytes" of arduino-cli output
+	sizes() {
+		arduino-cli compile -b "$FQBN" --library "$ROOT" --build-path "$BUILD" \
+			--build-property "compiler.cpp.extra_flags=$2" "$1" 2>/dev/null |
+			awk '/Sketch uses/ { flash = $3 } /Global variables use/ { ram = $4 } END { printf "%s %s", flash, ram }'
+	}
+
+	printf "%-20s %8s %8s %8s %8s\n" "example" "flash" "ram" "flash*" "ram*"
+fi
+
+for dir in "$ROOT"/examples/*/; do
+	dir=${dir%/}
+	name=$(basename "$dir")
+	[ -f "$dir/$name.ino" ] || continue
+	set -- $(sizes "$dir" "")
+	if [ -n "$HOST" ]; then
+		debug=$(printf "%8s %8s %8s" "${1:--}" "${2:--}" "${3:--}")
+		set -- $(sizes "$dir" "-DAGILE_SM_NO_NAMES")
+		printf "%-20s %s %8s %8s %8s\n" "$name" "$debug" "${1:--}" "${2:--}" "${3:--}"
+		continue
+	fi
+	debug_flash=$1 debug_ram=$2
+	set -- $(sizes "$dir" "-DAGILE_SM_NO_NAMES")
+	printf "%-20s %8s %8s %8s %8s\n" "$name" "${debug_flash:--}" "${debug_ram:--}" "${1:--}" "${2:--}"
+done
+echo "* built with AGILE_SM_NO_NAMES"
+rm -rf "$BUILD"
@@ -0,0 +1,76 @@
+#!/bin/sh
+# Footprint check on host: size of the engine types and heap allocations made by the example sketches
+# (setup() and 20 s of loop()), compared with baseline.txt. Fails if a value is greater than the baseline,
+# if MachineGraph::analyze() finds an issue in a machine of the examples, if an example doesn't build or run,
+# or if a value of the baseline is missing from the report.
+# Values depend on compiler and platform: the baseline is for g++ on x86-64 Linux.
+#
+# usage: extras/footprint/check.sh [--update]      (--update writes the current values as baseline)
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT="$DIR/../.."
+SRC="$ROOT/src"
+CXX=${CXX:-g++}
+FLAGS="-std=c++20 -O1 -I$DIR/../host -I$SRC"
+OUT=$(mktemp -d)
+REPORT="$OUT/report.txt"
+FAILED=0
+
+# Examples that need hardware libraries not in the host shim
+EXCLUDED="WarmRestart"      # EEPROM.h
+
+$CXX $FLAGS -DFOOTPRINT_SIZES "$SRC"/*.cpp "$DIR/footprint.cpp" -o "$OUT/sizes" || exit 1
+"$OUT/sizes" 2>> "$REPORT"
+
+for dir in "$ROOT"/examples/*/; do
+	name=$(basename "$dir")
+	[ -f "$dir/$name.ino" ] || continue
+	case " $EXCLUDED " in
+	*" $name "*)
+		echo "$name: excluded (needs a library not in extras/host)"
+		continue ;;
+	esac
+	if ! $CXX $FLAGS -I"$dir" -DFOOTPRINT_NAME="\"$name\"" -include Arduino.h -x c++ "$dir/$name.ino" -x none \
+		"$SRC"/*.cpp "$DIR/footprint.cpp" -Wl,--wrap=_ZN12StateMachine5startEv -o "$OUT/$name"; then
+		echo "FAIL     $name: build failed"
+		FAILED=1
+		continue
+	fi
+	if ! timeout 20 "$OUT/$name" > /dev/null 2>> "$REPORT"; then
+		echo "FAIL     $name: run failed"
+		FAILED=1
+	fi
+done
+
+if [ "$1" = "--update" ]; then
+	if [ $FAILED -ne 0 ]; then
+		echo "baseline not updated"
+		rm -rf "$OUT"
+		exit 1
+	fi
+	{
+		echo "# Footprint baseline (g++ on x86-64 Linux): written by check.sh --update"
+		sort "$REPORT"
+	} > "$DIR/baseline.txt"
+	echo "baseline updated"
+	rm -rf "$OUT"
+	exit 0
+fi
+
+sort "$REPORT" | awk -v failed=$FAILED '
+	NR == FNR { if ($1 !~ /^#/) base[$1] = $2; next }
+	/^#/ { print substr($0, 3); next }
+	{ seen[$1] = 1 }
+	$1 ~ /^analysis\./ && $2 > 0 { print "FAIL     " $1 " " $2; failed = 1; next }
+	!($1 in base) { print "new      " $1 " " $2; next }
+	$2 > base[$1] { print "FAIL     " $1 " " base[$1] " -> " $2; failed = 1; next }
+	$2 < base[$1] { print "smaller  " $1 " " base[$1] " -> " $2 " (update the baseline)" }
+	END {
+		for (key in base) if (!(key in seen)) { print "FAIL     " key " missing"; failed = 1 }
+		if (!failed) print "footprint ok"
+		exit failed
+	}
+' "$DIR/baseline.txt" -
+status=$?
+rm -rf "$OUT"
+exit $status
@@ -0,0 +1,146 @@
+/*
+* Host footprint report, linked by check.sh with each example sketch (or alone with -DFOOTPRINT_SIZES):
+* prints the size of the engine types, or the heap allocations made by setup() and by some loop() of the sketch.
+* Each machine of the sketch is also checked by MachineGraph::analyze() when it starts.
+* Report lines are "key value" on stderr (the sketch prints on stdout), compared by check.sh with the baseline;
+* lines starting with '#' are messages printed by check.sh.
+*/
+#include <new>
+#include "AgileStateMachine.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static bool counting = false;
+static unsigned long allocations = 0;
+static unsigned long allocated = 0;
+
+void *operator new(size_t size) {
+	if (counting) {
+		allocations++;
+		allocated += size;
+	}
+	void *ptr = malloc(size > 0 ? size : 1);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+
+#ifdef FOOTPRINT_SIZES
+#include "ActionWord.h"
+#include "CachedCondition.h"
+#include "EventBus.h"
+#include "Executive.h"
+#include "FlashStateMachine.h"
+#include "MachineRunner.h"
+#include "StateGroup.h"
+#include "TimerWheel.h"
+
+#define SIZE(type) fprintf(stderr, "sizeof.%s %u\n", #type, (unsigned)sizeof(type))
+
+int main() {
+	SIZE(State);
+	SIZE(Transition);
+	SIZE(Action);
+	SIZE(ActionWord);
+	SIZE(ActionRamp);
+	SIZE(StateMachine);
+	SIZE(OutputChanges);
+	SIZE(CachedCondition);
+	SIZE(EventQueue);
+	SIZE(EventBus);
+	SIZE(StateGroup);
+	SIZE(TimerWheel);
+	SIZE(WheelTimer);
+	SIZE(MachineRunner);
+	SIZE(Executive);
+	SIZE(FlashStateMachine);
+	return 0;
+}
+
+#else
+#include "MachineGraph.h"
+
+void setup();
+void loop();
+
+// Lines of the analysis printed on stderr as messages of the report
+class AnalysisPrint : public Print
+{
+public:
+	size_t write(uint8_t c) override {
+		if (m_lineStart) {
+			fprintf(stderr, "# %s: ", FOOTPRINT_NAME);
+			m_lineStart = false;
+		}
+		if (c == '\n') {
+			m_lineStart = true;
+			m_lines++;
+		}
+		return fputc(c, stderr) == EOF ? 0 : 1;
+	}
+
+	unsigned long getLines() const { return m_lines; }
+
+private:
+	bool m_lineStart = true;
+	unsigned long m_lines = 0;
+};
+
+static AnalysisPrint analysis;
+static const StateMachine *analyzed[16];
+static uint8_t analyzedCount = 0;
+
+// StateMachine::start() is wrapped by the linker (-Wl,--wrap): each machine is analyzed before its first start
+// (the allocations of the analysis are not counted)
+extern "C" void __real__ZN12StateMachine5startEv(StateMachine *fsm);
+
+extern "C" void __wrap__ZN12StateMachine5startEv(StateMachine *fsm) {
+	bool found = false;
+	for (uint8_t i = 0; i < analyzedCount && !found; i++) {
+		found = analyzed[i] == fsm;
+	}
+	if (!found && analyzedCount < sizeof(analyzed) / sizeof(analyzed[0])) {
+		analyzed[analyzedCount++] = fsm;
+		const bool wasCounting = counting;
+		counting = false;
+		MachineGraph(*fsm).analyze(analysis);
+		counting = wasCounting;
+	}
+	__real__ZN12StateMachine5startEv(fsm);
+}
+
+// Loops of the sketch with the allocations counted (1 ms of time each)
+static const uint32_t LOOPS = 20000;
+
+int main() {
+	counting = true;
+	setup();
+	counting = false;
+	fflush(stdout);
+	const unsigned long setupAllocations = allocations, setupBytes = allocated;
+
+	allocations = allocated = 0;
+	counting = true;
+	for (uint32_t i = 0; i < LOOPS; i++) {
+		hostMillis++;
+		loop();
+	}
+	counting = false;
+	fflush(stdout);
+
+	fprintf(stderr, "alloc.%s.setup.count %lu\n", FOOTPRINT_NAME, setupAllocations);
+	fprintf(stderr, "alloc.%s.setup.bytes %lu\n", FOOTPRINT_NAME, setupBytes);
+	fprintf(stderr, "alloc.%s.loop.count %lu\n", FOOTPRINT_NAME, allocations);
+	fprintf(stderr, "analysis.%s.issues %lu\n", FOOTPRINT_NAME, analysis.getLines());
+	return 0;
+}
+#endif
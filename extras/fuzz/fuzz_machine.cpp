@@ -0,0 +1,396 @@
+/*
+* Property test of the engine: random machines (states with min/max time, transitions on variables and timeouts
+* with priorities, actions of all types) are run step by step together with a small reference interpreter.
+* After each execute() the active state, the callbacks called and the outputs must be the same of the reference, and:
+*  - only one state is active, and it's the one that gets the exit callback;
+*  - each exit is followed by the enter of the next state (the initial state is active from start());
+*  - the outputs of a state are at rest value when its exit callback is called.
+*
+* The bytes of the input describe the machine, then inputs and time steps. The same entry point is used by libFuzzer
+* (build with -DAGILE_FUZZ_LIBFUZZER -fsanitize=fuzzer) and by the driver with random seeds of this file (see run.sh).
+*/
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "AgileStateMachine.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+// Seed of the input in the driver (0 with libFuzzer, that saves the input by itself)
+static uint32_t currentSeed = 0;
+
+#define FUZZ_CHECK(cond) do { if (!(cond)) { fuzzFailed(__FILE__, __LINE__, #cond); } } while (0)
+
+static void fuzzFailed(const char *file, int line, const char *what) {
+	fprintf(stderr, "%s:%d: FUZZ_CHECK(%s) failed", file, line, what);
+	if (currentSeed != 0) {
+		fprintf(stderr, " (seed %u)", currentSeed);
+	}
+	fprintf(stderr, "\n");
+	abort();
+}
+
+static const uint8_t MAX_STATES = 8;
+static const uint8_t INPUTS = 4;
+static const uint8_t SHARED = 2;
+static const uint8_t MAX_OUTPUTS = MAX_STATES * 3;
+static const uint16_t MAX_STEPS = 400;
+
+// Bytes of the fuzzer input (0 when exhausted)
+class FuzzInput
+{
+public:
+	FuzzInput(const uint8_t *data, size_t size) : m_data(data), m_size(size) {}
+
+	uint8_t next() { return m_pos < m_size ? m_data[m_pos++] : 0; }
+	uint8_t next(uint8_t range) { return next() % range; }
+	bool done() const { return m_pos >= m_size; }
+
+private:
+	const uint8_t *m_data;
+	size_t m_size;
+	size_t m_pos = 0;
+};
+
+enum CallbackKind : uint8_t { ENTER, EXIT, RUN };
+
+struct Call
+{
+	uint8_t kind;
+	uint8_t state;
+	bool operator!=(const Call &other) const { return kind != other.kind || state != other.state; }
+};
+
+struct RefTransition
+{
+	int8_t input;       // Index of input, -1 for a timeout
+	uint32_t timeout;
+	uint8_t priority;
+	uint8_t to;
+};
+
+struct RefAction
+{
+	uint8_t type;
+	bool *target;       // Output of the reference
+	bool *output;       // Output of the engine
+	bool own;           // Output driven only by this action (rest value checked on exit)
+	uint32_t delay;
+	uint32_t time = 0;
+	bool edge = false;
+	bool done = false;
+};
+
+struct RefState
+{
+	uint32_t min = 0;
+	uint32_t max = 0;
+	int8_t timeoutState = -1;
+	std::vector<RefTransition> transitions;     // In order of evaluation
+	std::vector<RefAction> actions;
+};
+
+// Machine under test and its reference
+struct Run
+{
+	StateMachine fsm;
+	std::vector<std::unique_ptr<State>> states;
+	std::vector<std::unique_ptr<Transition>> transitions;
+	std::vector<std::unique_ptr<Action>> actions;
+
+	bool inputs[INPUTS] = {};
+	bool outputs[MAX_OUTPUTS] = {};
+	bool shared[SHARED] = {};
+	std::vector<Call> calls;
+
+	RefState ref[MAX_STATES];
+	uint8_t refCount = 0;
+	bool refOutputs[MAX_OUTPUTS] = {};
+	bool refShared[SHARED] = {};
+	std::vector<Call> refCalls;
+	uint8_t current = 0;
+	uint32_t enterTime = 0;
+	bool timeout = false;
+};
+
+static Run *active = nullptr;
+
+static bool isRest(const RefAction &action, bool value) {
+	return action.type == Action::Type::FE ? value : !value;
+}
+
+// Callbacks of the states: log and check the invariants seen from inside the engine
+template <uint8_t I>
+static void onEnter() {
+	Run &run = *active;
+	FUZZ_CHECK(!run.calls.empty() && run.calls.back().kind == EXIT);
+	FUZZ_CHECK(run.fsm.getActiveStateId() == I);
+	run.calls.push_back({ENTER, I});
+}
+
+template <uint8_t I>
+static void onExit() {
+	Run &run = *active;
+	FUZZ_CHECK(run.fsm.getActiveStateId() == I);
+	for (const RefAction &action : run.ref[I].actions) {
+		FUZZ_CHECK(!action.own || isRest(action, *action.output));
+	}
+	run.calls.push_back({EXIT, I});
+}
+
+template <uint8_t I>
+static void onRun() {
+	active->calls.push_back({RUN, I});
+}
+
+template <size_t... I>
+static std::array<std::array<state_cb, 3>, sizeof...(I)> makeCallbacks(std::index_sequence<I...>) {
+	return {{{{onEnter<I>, onExit<I>, onRun<I>}}...}};
+}
+static const std::array<std::array<state_cb, 3>, MAX_STATES> callbacks = makeCallbacks(std::make_index_sequence<MAX_STATES>());
+
+static void build(Run &run, FuzzInput &in) {
+	run.refCount = 2 + in.next(MAX_STATES - 1);
+	uint8_t outputs = 0;
+	for (uint8_t i = 0; i < run.refCount; i++) {
+		RefState &ref = run.ref[i];
+		const uint8_t flags = in.next();
+		ref.min = (flags & 0x03) == 0 ? in.next(40) : 0;
+		ref.max = (flags & 0x0C) == 0 ? 1 + in.next(120) : 0;
+		run.states.emplace_back(new State("S", ref.min, ref.max, callbacks[i][ENTER], callbacks[i][EXIT], callbacks[i][RUN]));
+		run.fsm.addState(*run.states.back());
+	}
+
+	for (uint8_t i = 0; i < run.refCount; i++) {
+		RefState &ref = run.ref[i];
+		State &state = *run.states[i];
+		if (ref.max > 0 && in.next(2)) {
+			ref.timeoutState = in.next(run.refCount);
+			state.setStateMaxTime(ref.max, run.states[ref.timeoutState].get());
+		}
+
+		const uint8_t transitions = in.next(4);
+		for (uint8_t n = 0; n < transitions; n++) {
+			RefTransition tr;
+			tr.to = in.next(run.refCount);
+			tr.priority = in.next(4) == 0 ? 1 + in.next(2) : 0;
+			if (in.next(2)) {
+				tr.input = in.next(INPUTS);
+				tr.timeout = 0;
+				run.transitions.emplace_back(new Transition(run.states[tr.to].get(), run.inputs[tr.input]));
+			}
+			else {
+				tr.input = -1;
+				tr.timeout = 1 + in.next(150);
+				run.transitions.emplace_back(new Transition(run.states[tr.to].get(), tr.timeout));
+			}
+			run.transitions.back()->setPriority(tr.priority);
+			state.addTransition(*run.transitions.back());
+
+			// Stable order by priority, as sorted by start()
+			size_t pos = ref.transitions.size();
+			while (pos > 0 && ref.transitions[pos - 1].priority < tr.priority) {
+				pos--;
+			}
+			ref.transitions.insert(ref.transitions.begin() + pos, tr);
+		}
+
+		const uint8_t actions = in.next(4);
+		for (uint8_t n = 0; n < actions; n++) {
+			RefAction action;
+			action.type = in.next(Action::Type::P + 1);
+			action.delay = in.next(80);
+			action.own = action.type != Action::Type::S && action.type != Action::Type::R;
+			if (action.own) {
+				action.target = &run.refOutputs[outputs];
+				action.output = &run.outputs[outputs++];
+			}
+			else {
+				const uint8_t index = in.next(SHARED);
+				action.target = &run.refShared[index];
+				action.output = &run.shared[index];
+			}
+			run.actions.emplace_back(new Action(action.type, *action.output, action.delay));
+			state.addAction(*run.actions.back());
+			ref.actions.push_back(action);
+		}
+	}
+
+	run.current = in.next(run.refCount);
+	run.fsm.setInitialState(run.states[run.current].get());
+	run.fsm.setWriteOnChange(in.next(2));
+}
+
+// Same semantics of Action::execute() and Action::clear(), written in the plain way
+static void runAction(RefAction &action, uint32_t now) {
+	bool &target = *action.target;
+	const bool first = !action.edge;
+	if (first) {
+		action.edge = true;
+		action.time = now;
+	}
+	const uint32_t elapsed = now - action.time;
+	const uint32_t onTime = action.delay / 2;
+	switch (action.type) {
+		case Action::Type::N:
+		case Action::Type::S:
+			target = true;
+			break;
+		case Action::Type::R:
+			target = false;
+			break;
+		case Action::Type::L:
+			target = elapsed <= action.delay;
+			break;
+		case Action::Type::D:
+			if (first) {
+				target = false;
+			}
+			else if (!action.done && elapsed > action.delay) {
+				target = true;
+				action.done = true;
+			}
+			break;
+		case Action::Type::RE:
+			target = first;
+			break;
+		case Action::Type::P:
+			target = action.delay == 0 || elapsed % action.delay < onTime;
+			break;
+	}
+}
+
+static void clearAction(RefAction &action) {
+	if (action.type == Action::Type::S || action.type == Action::Type::R) {
+		return;
+	}
+	*action.target = action.type == Action::Type::FE;
+	action.edge = false;
+	action.done = false;
+}
+
+// One execute() of the reference: true if a transition was taken
+static bool refExecute(Run &run, uint32_t now) {
+	RefState &state = run.ref[run.current];
+	const uint32_t elapsed = now - run.enterTime;
+	int8_t next = -1;
+
+	if (state.max > 0 && elapsed >= state.max) {
+		run.timeout = true;
+		next = state.timeoutState;
+	}
+	if (next < 0 && elapsed >= state.min) {
+		for (const RefTransition &tr : state.transitions) {
+			if (tr.input >= 0 ? run.inputs[tr.input] : elapsed >= tr.timeout) {
+				next = tr.to;
+				break;
+			}
+		}
+	}
+
+	if (next >= 0) {
+		for (RefAction &action : state.actions) {
+			clearAction(action);
+		}
+		run.refCalls.push_back({EXIT, run.current});
+		run.current = next;
+		run.enterTime = now;
+		run.timeout = false;
+		run.refCalls.push_back({ENTER, run.current});
+		return true;
+	}
+
+	run.refCalls.push_back({RUN, run.current});
+	for (RefAction &action : state.actions) {
+		runAction(action, now);
+	}
+	return false;
+}
+
+static void checkSame(Run &run) {
+	FUZZ_CHECK(run.fsm.getActiveStateId() == run.current);
+	FUZZ_CHECK(run.fsm.getCurrentState() == run.states[run.current].get());
+	FUZZ_CHECK(run.fsm.getCurrentState()->getEnterTime() == run.enterTime);
+	FUZZ_CHECK(run.fsm.isStalled() == run.timeout);
+	FUZZ_CHECK(run.calls.size() == run.refCalls.size());
+	for (size_t i = 0; i < run.calls.size(); i++) {
+		FUZZ_CHECK(!(run.calls[i] != run.refCalls[i]));
+	}
+	for (uint8_t i = 0; i < MAX_OUTPUTS; i++) {
+		FUZZ_CHECK(run.outputs[i] == run.refOutputs[i]);
+	}
+	for (uint8_t i = 0; i < SHARED; i++) {
+		FUZZ_CHECK(run.shared[i] == run.refShared[i]);
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	FuzzInput in(data, size);
+	std::unique_ptr<Run> run(new Run);
+	active = run.get();
+	hostMillis = 1000 + ((uint32_t)in.next() << 24);    // Also across the overflow of millis()
+
+	build(*run, in);
+	run->fsm.start();
+	run->enterTime = hostMillis;
+	checkSame(*run);
+
+	for (uint16_t step = 0; step < MAX_STEPS && !in.done(); step++) {
+		const uint8_t op = in.next();
+		if (op & 0x80) {
+			run->inputs[op & (INPUTS - 1)] = !run->inputs[op & (INPUTS - 1)];
+		}
+
+		// Next millisecond, a random step or exactly the next deadline of the machine
+		const uint32_t deadline = run->fsm.getNextDeadline();
+		switch (op & 0x03) {
+			case 0:
+				hostMillis++;
+				break;
+			case 1:
+				hostMillis += in.next(64);
+				break;
+			default:
+				hostMillis += deadline < 500 ? deadline : 500;
+		}
+
+		run->calls.clear();
+		run->refCalls.clear();
+		const bool changed = run->fsm.execute();
+		FUZZ_CHECK(changed == refExecute(*run, hostMillis));
+		checkSame(*run);
+	}
+
+	active = nullptr;
+	return 0;
+}
+
+#ifndef AGILE_FUZZ_LIBFUZZER
+// Driver without libFuzzer: random inputs from consecutive seeds
+//   fuzz_machine [first seed] [count]
+static uint32_t nextRandom(uint32_t &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+int main(int argc, char *argv[]) {
+	const uint32_t first = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1;
+	const uint32_t count = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20000;
+	std::vector<uint8_t> data;
+	for (uint32_t seed = first; seed < first + count; seed++) {
+		uint32_t state = seed * 2654435761u + 1;
+		data.resize(64 + nextRandom(state) % 1024);
+		for (uint8_t &b : data) {
+			b = nextRandom(state);
+		}
+		currentSeed = seed;
+		LLVMFuzzerTestOneInput(data.data(), data.size());
+	}
+	printf("%u machines ok\n", count);
+	return 0;
+}
+#endif
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Property test of the engine against a reference interpreter (see fuzz_machine.cpp).
+#
+# usage: extras/fuzz/run.sh [first seed] [count]      random machines from consecutive seeds (g++ or CXX)
+#        extras/fuzz/run.sh --libfuzzer [options]     coverage guided with libFuzzer (clang++), options passed to the fuzzer
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/../../src"
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+FLAGS="-std=c++17 -g -O1 -Wall -Wextra -DAGILE_SM_CHECK_INVARIANTS $FLAGS -I$DIR/../host -I$SRC"
+
+if [ "$1" = "--libfuzzer" ]; then
+	shift
+	CXX=${CXX:-clang++}
+	$CXX $FLAGS -DAGILE_FUZZ_LIBFUZZER -fsanitize=fuzzer,address,undefined "$SRC"/*.cpp "$DIR/fuzz_machine.cpp" -o "$OUT/fuzz_machine" || exit 1
+	"$OUT/fuzz_machine" "$@"
+else
+	CXX=${CXX:-g++}
+	$CXX $FLAGS -fsanitize=address,undefined "$SRC"/*.cpp "$DIR/fuzz_machine.cpp" -o "$OUT/fuzz_machine" || exit 1
+	"$OUT/fuzz_machine" "$@"
+fi
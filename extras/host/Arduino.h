@@ -0,0 +1,68 @@
+// Minimal Arduino API for the host tools in extras (time is set by the tool, pins do nothing, Serial prints on stdout)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+extern uint32_t hostMillis;
+inline uint32_t millis() { return hostMillis; }
+inline uint32_t micros() { return hostMillis * 1000; }
+inline void delay(uint32_t ms) { hostMillis += ms; }
+inline void delayMicroseconds(unsigned int) {}
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define LED_BUILTIN 13
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }    // Idle inputs (buttons with pull-up)
+inline void analogWrite(uint8_t, int) {}
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(a) (*(const uint8_t *)(a))
+#define pgm_read_word(a) (*(const uint16_t *)(a))
+#define pgm_read_dword(a) (*(const uint32_t *)(a))
+#define pgm_read_ptr(a) (*(void *const *)(a))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+	size_t print(const char *s) { size_t n = 0; while (*s) n += write(*s++); return n; }
+	size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+	size_t print(char c) { return write(c); }
+	size_t print(unsigned long v) { char b[12]; snprintf(b, sizeof(b), "%lu", v); return print(b); }
+	size_t print(long v) { char b[12]; snprintf(b, sizeof(b), "%ld", v); return print(b); }
+	size_t print(unsigned int v) { return print((unsigned long)v); }
+	size_t print(int v) { return print((long)v); }
+	size_t print(unsigned char v) { return print((unsigned long)v); }
+	template <typename T> size_t println(T v) { return print(v) + print("\n"); }
+	size_t println() { return print("\n"); }
+	void begin(unsigned long) {}
+};
+
+extern Print Serial;
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
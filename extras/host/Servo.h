@@ -0,0 +1,9 @@
+// Servo stub for the host tools in extras
+#pragma once
+
+class Servo
+{
+public:
+	void attach(int) {}
+	void write(int) {}
+};
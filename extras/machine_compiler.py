@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Compile a readable description of a state machine into the compact binary
+format loaded at runtime by MachineLoader (see src/MachineLoader.cpp).
+
+Text description (one statement for each line, '#' for comments):
+
+    state Closed enter=onEnter exit=onLeave initial
+    state "Stop & Wait" enter=onEnterWait exit=onLeave min=0 max=0 run=onRun
+    transition Closed -> Opening var inStartButton      # bool variable
+    transition Opening -> Opened after 10000            # timeout
+    transition Opened -> Closing when isTimeToClose     # callback function
+    action Opening D outOpen 2000                       # type, target, time
+
+JSON description (file with .json extension):
+
+    {"initial": "Closed",
+     "states": [{"name": "Closed", "enter": "onEnter", "exit": "onLeave"}],
+     "transitions": [{"from": "Closed", "to": "Opening", "var": "inStartButton"},
+                     {"from": "Opening", "to": "Opened", "after": 10000},
+                     {"from": "Opened", "to": "Closing", "when": "isTimeToClose"}],
+     "actions": [{"state": "Opening", "type": "D", "target": "outOpen", "time": 2000}]}
+
+Names of variables and functions are resolved at runtime with the
+MachineBinding table passed to MachineLoader.
+
+usage: machine_compiler.py machine.fsm [-o output] [--format c|bin] [--name symbol]
+"""
+
+import argparse
+import json
+import shlex
+import sys
+
+FORMAT_VERSION = 1
+ACTION_TYPES = {"N": 0, "S": 1, "R": 2, "L": 3, "D": 4, "RE": 5, "FE": 6, "P": 7}
+TRIGGER_VARIABLE, TRIGGER_CALLBACK, TRIGGER_TIMEOUT = 0, 1, 2
+
+
+class Machine:
+    def __init__(self):
+        self.states = []        # dict: name, min, max, enter, exit, run
+        self.transitions = []   # dict: from, to, kind, value
+        self.actions = []       # dict: state, type, target, time
+        self.initial = None
+
+    def index(self, name):
+        for i, state in enumerate(self.states):
+            if state["name"] == name:
+                return i
+        raise ValueError("state '%s' not defined" % name)
+
+
+def parse_text(text):
+    machine = Machine()
+    for num, line in enumerate(text.splitlines(), 1):
+        try:
+            words = shlex.split(line, comments=True)
+            if not words:
+                continue
+            keyword, args = words[0], words[1:]
+
+            if keyword == "state":
+                state = {"name": args[0], "min": 0, "max": 0, "enter": "", "exit": "", "run": ""}
+                for arg in args[1:]:
+                    if arg == "initial":
+                        machine.initial = args[0]
+                        continue
+                    key, value = arg.split("=", 1)
+                    if key not in state or key == "name":
+                        raise ValueError("unknown attribute '%s'" % key)
+                    state[key] = int(value) if key in ("min", "max") else value
+                machine.states.append(state)
+
+            elif keyword == "transition":
+                if len(args) != 5 or args[1] != "->":
+                    raise ValueError("expected: transition FROM -> TO var|when|after VALUE")
+                machine.transitions.append(trigger(args[0], args[2], args[3], args[4]))
+
+            elif keyword == "action":
+                if len(args) not in (3, 4):
+                    raise ValueError("expected: action STATE TYPE TARGET [TIME]")
+                time = int(args[3]) if len(args) == 4 else 0
+                machine.actions.append({"state": args[0], "type": args[1], "target": args[2], "time": time})
+
+            else:
+                raise ValueError("unknown statement '%s'" % keyword)
+        except (ValueError, IndexError) as err:
+            raise SystemExit("line %d: %s" % (num, err))
+    return machine
+
+
+def parse_json(text):
+    data = json.loads(text)
+    machine = Machine()
+    for state in data["states"]:
+        machine.states.append({"name": state["name"], "min": state.get("min", 0), "max": state.get("max", 0),
+                               "enter": state.get("enter", ""), "exit": state.get("exit", ""),
+                               "run": state.get("run", "")})
+    machine.initial = data.get("initial")
+    for tr in data.get("transitions", []):
+        for kind in ("var", "when", "after"):
+            if kind in tr:
+                machine.transitions.append(trigger(tr["from"], tr["to"], kind, tr[kind]))
+                break
+        else:
+            raise SystemExit("transition %s -> %s without trigger" % (tr["from"], tr["to"]))
+    for action in data.get("actions", []):
+        machine.actions.append({"state": action["state"], "type": action["type"],
+                                "target": action["target"], "time": action.get("time", 0)})
+    return machine
+
+
+def trigger(src, dst, kind, value):
+    if kind == "var":
+        return {"from": src, "to": dst, "kind": TRIGGER_VARIABLE, "value": value}
+    if kind == "when":
+        return {"from": src, "to": dst, "kind": TRIGGER_CALLBACK, "value": value}
+    if kind == "after":
+        return {"from": src, "to": dst, "kind": TRIGGER_TIMEOUT, "value": int(value)}
+    raise ValueError("unknown trigger '%s' (var, when or after)" % kind)
+
+
+def leb128(value):
+    if value < 0 or value > 0xFFFFFFFF:
+        raise SystemExit("time %d out of range" % value)
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def name(text):
+    return text.encode("ascii") + b"\0"
+
+
+def compile_machine(machine):
+    if not machine.states:
+        raise SystemExit("no states defined")
+    if len(machine.states) > 255 or len(machine.transitions) > 255 or len(machine.actions) > 255:
+        raise SystemExit("too many states, transitions or actions (max 255)")
+
+    out = bytearray(b"ASM")
+    out.append(FORMAT_VERSION)
+    out.append(len(machine.states))
+    out.append(machine.index(machine.initial) if machine.initial else 0)
+    for state in machine.states:
+        out += name(state["name"]) + leb128(state["min"]) + leb128(state["max"])
+        out += name(state["enter"]) + name(state["exit"]) + name(state["run"])
+
+    out.append(len(machine.transitions))
+    for tr in machine.transitions:
+        out += bytes([machine.index(tr["from"]), machine.index(tr["to"]), tr["kind"]])
+        out += leb128(tr["value"]) if tr["kind"] == TRIGGER_TIMEOUT else name(tr["value"])
+
+    out.append(len(machine.actions))
+    for action in machine.actions:
+        if action["type"] not in ACTION_TYPES:
+            raise SystemExit("unknown action type '%s'" % action["type"])
+        out += bytes([machine.index(action["state"]), ACTION_TYPES[action["type"]]])
+        out += name(action["target"]) + leb128(action["time"])
+    return bytes(out)
+
+
+def to_c_array(data, symbol):
+    lines = ["// Generated by machine_compiler.py, do not edit",
+             "const uint8_t %s[] = {" % symbol]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a state machine description for MachineLoader")
+    parser.add_argument("input", help="text (.fsm) or JSON (.json) description")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    parser.add_argument("--format", choices=("c", "bin"), default="c", help="C array or raw binary")
+    parser.add_argument("--name", default="machine", help="name of the C array")
+    args = parser.parse_args()
+
+    with open(args.input) as f:
+        text = f.read()
+    machine = parse_json(text) if args.input.endswith(".json") else parse_text(text)
+    data = compile_machine(machine)
+
+    if args.format == "bin":
+        if not args.output:
+            raise SystemExit("--format bin needs an output file")
+        with open(args.output, "wb") as f:
+            f.write(data)
+    elif args.output:
+        with open(args.output, "w") as f:
+            f.write(to_c_array(data, args.name))
+    else:
+        sys.stdout.write(to_c_array(data, args.name))
+
+
+if __name__ == "__main__":
+    main()
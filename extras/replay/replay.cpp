@@ -0,0 +1,248 @@
+/*
+* Replay of a recorded input trace on Linux: the machine is loaded from its binary description
+* (extras/machine_compiler.py --format bin) and driven by Simulator with a virtual clock,
+* the transitions log ("time state" for each line) is printed on stdout to be compared with diff.
+*
+* Trace: one change of an input for each line, "time name value" (milliseconds from start, value 0 or 1),
+* sorted by time, '#' starts a comment. Inputs are the variables and the conditions ("when") of the machine,
+* all false at start; the callbacks of the states do nothing.
+*
+* usage: replay machine.bin trace.txt duration      (see run.sh)
+*/
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MachineLoader.h"
+#include "Simulator.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static const uint8_t MAX_INPUTS = 32;
+static bool inputs[MAX_INPUTS];
+
+// Conditions of the machine read the value of an input: one function for each slot
+template <size_t... N>
+static constexpr std::array<condition_cb, sizeof...(N)> makeConditions(std::index_sequence<N...>) {
+	return {{[]() { return inputs[N]; }...}};
+}
+static const std::array<condition_cb, MAX_INPUTS> conditions = makeConditions(std::make_index_sequence<MAX_INPUTS>());
+
+static void doNothing() {}
+
+struct Input
+{
+	std::string name;
+	uint8_t kind;       // MachineBinding::VARIABLE or CONDITION
+};
+
+// Names used by the description (same layout read by MachineLoader)
+class NameScanner
+{
+public:
+	NameScanner(const std::vector<uint8_t> &data) : m_data(data) {}
+
+	bool scan(std::vector<Input> &inputs, std::vector<std::string> &callbacks) {
+		m_pos = 4;
+		uint8_t states, count, initial, from, to, kind, index, type;
+		uint32_t time;
+		std::string name;
+		if (!byte(states) || !byte(initial)) {
+			return false;
+		}
+		for (uint8_t i = 0; i < states; i++) {
+			if (!text(name) || !leb128(time) || !leb128(time)) {
+				return false;
+			}
+			for (uint8_t cb = 0; cb < 3; cb++) {
+				if (!text(name)) {
+					return false;
+				}
+				if (!name.empty()) {
+					callbacks.push_back(name);
+				}
+			}
+		}
+
+		if (!byte(count)) {
+			return false;
+		}
+		for (uint8_t i = 0; i < count; i++) {
+			if (!byte(from) || !byte(to) || !byte(kind)) {
+				return false;
+			}
+			if (kind == Transition::ON_TIMEOUT) {
+				if (!leb128(time)) {
+					return false;
+				}
+				continue;
+			}
+			if (!text(name)) {
+				return false;
+			}
+			inputs.push_back({name, kind == Transition::ON_VARIABLE ? MachineBinding::VARIABLE : MachineBinding::CONDITION});
+		}
+
+		if (!byte(count)) {
+			return false;
+		}
+		for (uint8_t i = 0; i < count; i++) {
+			if (!byte(index) || !byte(type) || !text(name) || !leb128(time)) {
+				return false;
+			}
+			inputs.push_back({name, MachineBinding::VARIABLE});
+		}
+		return true;
+	}
+
+private:
+	bool byte(uint8_t &value) {
+		if (m_pos >= m_data.size()) {
+			return false;
+		}
+		value = m_data[m_pos++];
+		return true;
+	}
+
+	bool leb128(uint32_t &value) {
+		uint8_t b = 0x80;
+		value = 0;
+		for (uint8_t shift = 0; (b & 0x80) && shift < 35; shift += 7) {
+			if (!byte(b)) {
+				return false;
+			}
+			value |= (uint32_t)(b & 0x7F) << shift;
+		}
+		return !(b & 0x80);
+	}
+
+	bool text(std::string &value) {
+		value.clear();
+		uint8_t c;
+		while (byte(c)) {
+			if (c == '\0') {
+				return true;
+			}
+			value += (char)c;
+		}
+		return false;
+	}
+
+	const std::vector<uint8_t> &m_data;
+	size_t m_pos = 0;
+};
+
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	uint8_t buffer[256];
+	size_t len;
+	while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + len);
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4) {
+		fprintf(stderr, "usage: %s machine.bin trace.txt duration\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<uint8_t> description;
+	std::vector<Input> names;
+	std::vector<std::string> callbacks;
+	if (!readFile(argv[1], description)) {
+		fprintf(stderr, "%s: can't read\n", argv[1]);
+		return 1;
+	}
+	if (!NameScanner(description).scan(names, callbacks)) {
+		fprintf(stderr, "%s: not a valid machine description\n", argv[1]);
+		return 1;
+	}
+
+	// Bindings: one input slot for each name (also when used both as variable and as condition)
+	std::vector<std::string> slots;
+	slots.reserve(MAX_INPUTS);      // names are referenced by the bindings
+	std::vector<MachineBinding> bindings;
+	for (const Input &input : names) {
+		size_t slot = 0;
+		while (slot < slots.size() && slots[slot] != input.name) {
+			slot++;
+		}
+		if (slot == slots.size()) {
+			if (slot == MAX_INPUTS) {
+				fprintf(stderr, "more than %u inputs\n", MAX_INPUTS);
+				return 1;
+			}
+			slots.push_back(input.name);
+		}
+		if (input.kind == MachineBinding::VARIABLE) {
+			bindings.emplace_back(slots[slot].c_str(), inputs[slot]);
+		}
+		else {
+			bindings.emplace_back(slots[slot].c_str(), conditions[slot]);
+		}
+	}
+	for (const std::string &name : callbacks) {
+		bindings.emplace_back(name.c_str(), doNothing);
+	}
+
+	StateMachine fsm;
+	MachineLoader loader(bindings.data(), bindings.size());
+	const MachineLoader::Error error = loader.load(fsm, description.data(), description.size());
+	if (error != MachineLoader::LOAD_OK) {
+		fprintf(stderr, "%s: load error %u at offset %u\n", argv[1], error, (unsigned)loader.getPosition());
+		return 1;
+	}
+
+	// Trace
+	FILE *file = fopen(argv[2], "r");
+	if (file == nullptr) {
+		fprintf(stderr, "%s: can't read\n", argv[2]);
+		return 1;
+	}
+	std::vector<SimEvent> trace;
+	char line[128];
+	for (unsigned num = 1; fgets(line, sizeof(line), file) != nullptr; num++) {
+		char *comment = strchr(line, '#');
+		if (comment != nullptr) {
+			*comment = '\0';
+		}
+		unsigned long time;
+		char name[64];
+		int value;
+		const int fields = sscanf(line, "%lu %63s %d", &time, name, &value);
+		if (fields <= 0) {
+			continue;
+		}
+		size_t slot = 0;
+		while (slot < slots.size() && slots[slot] != name) {
+			slot++;
+		}
+		if (fields != 3 || slot == slots.size() || (!trace.empty() && time < trace.back().time)) {
+			fprintf(stderr, "%s:%u: expected \"time input value\" sorted by time, inputs of the machine\n", argv[2], num);
+			fclose(file);
+			return 1;
+		}
+		trace.push_back({(uint32_t)time, &inputs[slot], value != 0});
+	}
+	fclose(file);
+	if (trace.size() > UINT16_MAX) {
+		fprintf(stderr, "%s: more than %u changes\n", argv[2], UINT16_MAX);
+		return 1;
+	}
+
+	Simulator sim(fsm);
+	sim.setTrace(trace.data(), trace.size());
+	sim.setLog(Serial);
+	const uint32_t transitions = sim.run(strtoul(argv[3], nullptr, 10));
+	fprintf(stderr, "%u transitions, %u steps\n", transitions, sim.getSteps());
+	return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Replay of a recorded trace on Linux: the machine description is compiled with extras/machine_compiler.py,
+# the runner is built with the library sources and the Arduino shim of extras/host.
+# The transitions log is printed on stdout (i.e. save it and compare the next runs with diff).
+#
+# usage: extras/replay/run.sh machine.fsm trace.txt duration      (CXX to change compiler)
+
+set -e
+if [ $# -ne 3 ]; then
+	echo "usage: $0 machine.fsm trace.txt duration" >&2
+	exit 2
+fi
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/../../src"
+CXX=${CXX:-g++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+python3 "$DIR/../machine_compiler.py" "$1" --format bin -o "$OUT/machine.bin"
+$CXX -std=c++17 -O1 -Wall -Wextra -I"$DIR/../host" -I"$SRC" "$SRC"/*.cpp "$DIR/replay.cpp" -o "$OUT/replay"
+"$OUT/replay" "$OUT/machine.bin" "$2" "$3"
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Generate the table of state names for sketches built with AGILE_SM_NO_NAMES.
+
+In release builds states have no name: getActiveStateName(), printName() and
+the graphs of MachineGraph show the ID of the state, that is its index in the
+order the states were added to the machine. This script reads the sources of
+the sketch (the same files compiled in the debug build, with the names) and
+rebuilds the table ID -> name for each machine, to be used by host tools
+(i.e. to decode serial logs or to label the graphs).
+
+Recognized definitions:
+
+    State stIdle("Idle", onEnter);          // State objects (also F() names)
+    fsm.addState(stIdle);
+    State *stRun = fsm.addState("Run", 5000, onEnter);
+
+    Waiting() : StateImpl("Waiting") {}     // Classes derived from State with
+    Waiting stWaiting;                      // the name set by the constructor
+
+States are numbered in the order the addState() calls appear in the sources,
+for each machine variable: states added in loops or in functions called with
+different machines must be checked by hand.
+
+usage: state_names.py sketch.ino [other sources] [--format text|json|c]
+"""
+
+import argparse
+import json
+import re
+import sys
+
+STRING = r'(?:F\(\s*)?"((?:[^"\\]|\\.)*)"'
+DECLARATION = re.compile(r'\b([A-Za-z_]\w*)\s+([A-Za-z_]\w*)\s*\(\s*' + STRING)
+ADD_STATE = re.compile(r'([A-Za-z_][\w\[\]]*)\s*(?:\.|->)\s*addState\s*\(\s*(?:' + STRING + r'|&?\s*([A-Za-z_]\w*)\s*\))')
+CONSTRUCTOR = re.compile(r'\b([A-Za-z_]\w*)\s*\([^()]*\)\s*:\s*(?:StateImpl|CoState|State)\b[^(;]*\(\s*' + STRING)
+OBJECT = re.compile(r'\b([A-Za-z_]\w*)\s+([A-Za-z_]\w*)\s*;')
+KEYWORDS = ("return", "else", "case", "new", "delete")
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', lambda m: "\n" * m.group(0).count("\n"), text, flags=re.S)
+    return re.sub(r'//[^\n]*', "", text)
+
+
+def parse(sources):
+    classes = {}        # class derived from State -> name
+    objects = {}        # variable of a state object -> name
+    machines = {}       # machine variable -> list of names (index = ID)
+    sources = [strip_comments(text) for text in sources]
+    for text in sources:
+        for match in CONSTRUCTOR.finditer(text):
+            classes[match.group(1)] = match.group(2)
+    for text in sources:
+        for match in OBJECT.finditer(text):
+            if match.group(1) in classes:
+                objects[match.group(2)] = classes[match.group(1)]
+        for match in DECLARATION.finditer(text):
+            if match.group(1) not in KEYWORDS:
+                objects[match.group(2)] = match.group(3)
+        for match in ADD_STATE.finditer(text):
+            fsm, literal, variable = match.groups()
+            if literal is not None:
+                state = literal
+            else:
+                state = objects.get(variable, variable)
+            machines.setdefault(fsm, []).append(state)
+    return machines
+
+
+def to_text(machines):
+    lines = []
+    for fsm, names in machines.items():
+        for index, state in enumerate(names):
+            lines.append("%s %d %s" % (fsm, index, state))
+    return "\n".join(lines) + "\n"
+
+
+def to_c(machines):
+    lines = ["// State names of the release build (generated by state_names.py)"]
+    for fsm, names in machines.items():
+        symbol = re.sub(r'\W', "_", fsm)
+        lines.append("const char *const %s_names[] = {" % symbol)
+        for index, state in enumerate(names):
+            lines.append('    "%s",    // %d' % (state, index))
+        lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Table of state names for builds with AGILE_SM_NO_NAMES")
+    parser.add_argument("sources", nargs="+", help="sources of the sketch (.ino, .cpp, .h)")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    parser.add_argument("--format", choices=("text", "json", "c"), default="text",
+                        help="lines 'machine id name', JSON object of lists or C arrays")
+    args = parser.parse_args()
+
+    sources = []
+    for path in args.sources:
+        with open(path) as f:
+            sources.append(f.read())
+    machines = parse(sources)
+    if not machines:
+        raise SystemExit("no addState() found")
+
+    if args.format == "json":
+        out = json.dumps(machines, indent=2) + "\n"
+    elif args.format == "c":
+        out = to_c(machines)
+    else:
+        out = to_text(machines)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(out)
+    else:
+        sys.stdout.write(out)
+
+
+if __name__ == "__main__":
+    main()
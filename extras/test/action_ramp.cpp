@@ -0,0 +1,51 @@
+/*
+* Ramps: value at the time of each tick and deadline of the next step, for the default ramp_t and for wide types
+* with products that don't fit in 32 bits (run also with FLAGS=-DAGILE_RAMP_T=int32_t).
+*/
+#include "AgileStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+// Run a ramp from "from" to "to" for some time and check its value every "every" ms against the linear interpolation
+static void checkRamp(ramp_t from, ramp_t to, uint32_t rate, uint32_t duration, uint32_t every) {
+	StateMachine fsm;
+	State *stMove = fsm.addState("MOVE", nullptr);
+	ramp_t value = from;
+	stMove->addRamp(value, to, rate);
+	fsm.setInitialState(stMove);
+	fsm.start();
+
+	// First run of the state: the ramp starts from the value of the target
+	fsm.execute();
+	const uint32_t start = hostMillis;
+	const double span = (double)to - (double)from;
+	for (uint32_t time = every; time <= duration + every; time += every) {
+		hostMillis = start + time;
+		fsm.execute();
+		const double expected = (time * (double)rate / 1000 >= (span < 0 ? -span : span)) ? to
+			: from + (span < 0 ? -1 : 1) * (double)(uint64_t)(time * (double)rate / 1000);
+		CHECK((double)value == expected);
+		if (value != to) {
+			CHECK(fsm.getNextDeadline() <= every * 2 + 1000000000UL / rate);
+		}
+	}
+	if (duration * (double)rate / 1000 >= (span < 0 ? -span : span)) {
+		CHECK(value == to);
+		CHECK_EQ(fsm.getNextDeadline(), UINT32_MAX);
+	}
+}
+
+int main() {
+	checkRamp(0, 1000, 100, 10000, 250);
+	checkRamp(90, -90, 60, 3000, 1);
+	checkRamp(-32768, 32767, 1000, 65535, 100);
+
+	if (sizeof(ramp_t) > 2) {
+		// Distance * 1000 and time * rate need more than 32 bits
+		checkRamp((ramp_t)-2000000000L, (ramp_t)2000000000L, 1000000000UL, 4000, 10);
+		checkRamp((ramp_t)2000000000L, (ramp_t)-2000000000L, 7, 1000, 100);
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+/*
+* CachedCondition with plain execute() (no runner advancing the tick): the value follows the input every millisecond,
+* and it's shared by the machines executed in the same millisecond.
+*/
+#include "AgileStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static bool level = false;
+static bool readLevel() { return level; }
+static CachedCondition full(readLevel);
+
+struct Machine
+{
+	StateMachine fsm;
+
+	void setup() {
+		State *stFilling = fsm.addState("Filling", nullptr);
+		State *stFull = fsm.addState("Full", nullptr);
+		stFilling->addTransition(stFull, full);
+		stFull->addTransition(stFilling, 5);
+		fsm.setInitialState(stFilling);
+		fsm.start();
+	}
+};
+
+int main() {
+	Machine a, b;
+	a.setup();
+	b.setup();
+
+	for (uint8_t i = 0; i < 10; i++) {
+		hostMillis++;
+		CHECK(!a.fsm.execute());
+		CHECK(!b.fsm.execute());
+	}
+	CHECK_EQ(full.getCalls(), 10);      // Once per millisecond, shared by the two machines
+
+	// Input changed: seen at the next millisecond without nextTick()
+	level = true;
+	CHECK(!a.fsm.execute());
+	hostMillis++;
+	CHECK(a.fsm.execute());
+	CHECK(b.fsm.execute());
+	CHECK_EQ(full.getCalls(), 11);
+
+	// nextTick() reads the input again in the same millisecond
+	level = false;
+	hostMillis += 10;
+	CHECK(a.fsm.execute());
+	CHECK(b.fsm.execute());
+	CHECK(!a.fsm.execute());
+	level = true;
+	CHECK(!a.fsm.execute());     // Value read in this millisecond
+	CachedCondition::nextTick();
+	CHECK(a.fsm.execute());
+	return 0;
+}
@@ -0,0 +1,7 @@
+// Checks of the host tests: a failed check prints file, line and expression and ends the test with status 1
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); exit(1); } } while (0)
+#define CHECK_EQ(a, b) do { if ((a) != (b)) { fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %ld != %ld\n", __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); exit(1); } } while (0)
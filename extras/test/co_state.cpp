@@ -0,0 +1,50 @@
+/*
+* CoState driven by a TimerWheel: entered by a timed transition, the body starts, its delays are resumed by the wheel
+* and the transition on the end of the body is taken, without calling execute() of the machine.
+*/
+#include "StateTask.h"
+#include "TimerWheel.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static uint8_t steps;
+static uint32_t stepTime[3];
+
+static StateTask body() {
+	stepTime[steps++] = millis();
+	co_await taskDelay(50);
+	stepTime[steps++] = millis();
+	co_await taskDelay(30);
+	stepTime[steps++] = millis();
+}
+
+int main() {
+	StateMachine fsm;
+	State stIdle("IDLE", nullptr);
+	CoState stBody("BODY", body);
+	State stEnd("END", nullptr);
+	fsm.addState(stIdle);
+	fsm.addState(stBody);
+	fsm.addState(stEnd);
+	stIdle.addTransition(&stBody, 100);
+	stBody.addTransition(&stEnd, CoState::done);
+	fsm.setInitialState(stIdle);
+	fsm.start();
+
+	TimerWheel wheel;
+	wheel.add(fsm);
+	for (uint32_t tick = 0; tick < 400; tick++) {
+		hostMillis++;
+		wheel.run();
+	}
+
+	CHECK(fsm.getCurrentState() == &stEnd);
+	CHECK_EQ(steps, 3);
+	CHECK_EQ(stepTime[1] - stepTime[0], 50);
+	CHECK_EQ(stepTime[2] - stepTime[1], 30);
+	CHECK(stepTime[0] <= 102);
+	CHECK_EQ(StateTask::getFramesUsed(), 0);
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+* EventBus: machines and bus destroyed in any order (run with FLAGS=-fsanitize=address to catch a use after free),
+* and an event is not lost when a transition not triggered by events leaves the state.
+*/
+#include "AgileStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static const AgileEvent GO(3);
+
+struct Machine
+{
+	StateMachine fsm;
+	bool inSkip = false;
+	State *stWait, *stReady, *stDone;
+
+	void setup(EventBus &bus) {
+		stWait = fsm.addState("Wait", nullptr);
+		stReady = fsm.addState("Ready", nullptr);
+		stDone = fsm.addState("Done", nullptr);
+		stWait->addTransition(stReady, inSkip)->setPriority(1);
+		stWait->addTransition(stDone, GO);
+		stReady->addTransition(stDone, GO);
+		fsm.setInitialState(stWait);
+		bus.subscribe(fsm);
+		fsm.start();
+	}
+};
+
+int main() {
+	// Machine destroyed before the bus
+	EventBus *bus = new EventBus;
+	Machine *machine = new Machine;
+	machine->setup(*bus);
+	Machine other;
+	other.setup(*bus);
+	CHECK(machine->fsm.getEventQueue() != nullptr);
+	delete machine;
+	CHECK(bus->publish(GO));
+	CHECK(other.fsm.execute());
+	CHECK_EQ(other.fsm.getActiveStateId(), other.stDone->getIndex());
+
+	// Bus destroyed before the machine: the machine is unsubscribed
+	delete bus;
+	CHECK(other.fsm.getEventQueue() == nullptr);
+	CHECK(!other.fsm.execute());
+
+	// Unsubscribe and subscribe again
+	EventBus local;
+	Machine waiting;
+	waiting.setup(local);
+	local.unsubscribe(waiting.fsm);
+	CHECK(waiting.fsm.getEventQueue() == nullptr);
+	local.subscribe(waiting.fsm);
+	CHECK(waiting.fsm.getEventQueue() != nullptr);
+
+	// A variable with higher priority leaves Wait: the event is handled by the next state
+	waiting.inSkip = true;
+	CHECK(local.publish(GO));
+	hostMillis++;
+	CHECK(waiting.fsm.execute());
+	CHECK_EQ(waiting.fsm.getActiveStateId(), waiting.stReady->getIndex());
+	CHECK(waiting.fsm.getEvent() == nullptr);
+	CHECK_EQ(waiting.fsm.getEventQueue()->getCount(), 1);
+	hostMillis++;
+	CHECK(waiting.fsm.execute());
+	CHECK_EQ(waiting.fsm.getActiveStateId(), waiting.stDone->getIndex());
+	CHECK(waiting.fsm.getEvent() != nullptr && waiting.fsm.getEvent()->id == GO.id);
+	CHECK_EQ(waiting.fsm.getEventQueue()->getCount(), 0);
+	return 0;
+}
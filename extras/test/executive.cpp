@@ -0,0 +1,67 @@
+/*
+* Executive on Linux: runFor() driven by a timerfd, with a slow group that makes the fast one lose releases.
+* Each release is either run or counted as overrun, and the jitter is a real delay (never a negative one wrapped around).
+* In timer mode the groups added later are released by their own countdown of the ticks.
+*/
+#include "Executive.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static uint32_t fastRuns = 0;
+static void onFast() { fastRuns++; }
+
+// Slow run every 10 ms: the 1 ms timer expires 3 times meanwhile
+static void onSlow() {
+	const uint32_t start = Executive::now();
+	while (Executive::now() - start < 3000) {
+	}
+}
+
+int main() {
+	StateMachine fast, slow;
+	fast.addState("Fast", nullptr, nullptr, onFast);
+	slow.addState("Slow", nullptr, nullptr, onSlow);
+	fast.start();
+	slow.start();
+
+	StateMachine *const fastGroup[] = {&fast};
+	StateMachine *const slowGroup[] = {&slow};
+	Executive executive;
+	CHECK(executive.addGroup(10000, slowGroup));
+	CHECK(executive.addGroup(1000, fastGroup));
+	CHECK_EQ(executive.getBasePeriod(), 1000);
+
+	const uint32_t ticks = executive.runFor(300);
+	CHECK(ticks >= 300);
+	CHECK_EQ(executive.getTicks(), ticks);
+	const RateGroup *fastStats = executive.getGroup(0);
+	const RateGroup *slowStats = executive.getGroup(1);
+	CHECK_EQ(fastStats->period, 1000);
+	CHECK_EQ(fastStats->runs + fastStats->overruns, ticks);
+	CHECK_EQ(slowStats->runs + slowStats->overruns, ticks / 10);
+	CHECK_EQ(fastStats->runs, fastRuns);
+	CHECK(fastStats->overruns > 0);
+	CHECK(slowStats->maxDuration >= 3000);
+	CHECK(fastStats->maxJitter < 50000);
+	CHECK(slowStats->maxJitter < 50000);
+
+	// Timer mode: the first tick() is the first release (no delay)
+	Executive timer;
+	CHECK(timer.addGroup(1000, fastGroup));
+	CHECK_EQ(timer.tick(), 1);
+	CHECK(timer.getGroup(0)->maxJitter < 1000);
+
+	// Groups added later restart the release times: 1 ms and 3 ms groups, released by counting down the ticks
+	CHECK(timer.addGroup(3000, slowGroup));
+	uint32_t executed = 0;
+	for (uint8_t i = 0; i < 30; i++) {
+		executed += timer.tick();
+	}
+	CHECK_EQ(executed, 40);
+	CHECK_EQ(timer.getGroup(0)->runs, 30);
+	CHECK_EQ(timer.getGroup(1)->runs, 10);
+	CHECK_EQ(timer.getGroup(1)->overruns, 0);
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+* FlashStateMachine and StateMachine with the same definition: same states and outputs at every tick
+* (max time policies, min time, D actions set once, P actions with on time), and start() without states.
+*/
+#include "AgileStateMachine.h"
+#include "FlashStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+enum { IDLE, RUN, ALARM, WAIT };
+
+static bool inStart, inReset;
+static bool ramDelay, ramPulse, ramLimit, flashDelay, flashPulse, flashLimit;
+static uint8_t ramStalls, flashStalls;
+
+static void onRamStall(State *, uint32_t) { ramStalls++; }
+static void onFlashStall(uint8_t state, uint32_t) {
+	CHECK_EQ(state, WAIT);
+	flashStalls++;
+}
+
+// RUN times out to ALARM before its min time, WAIT only calls the stall handler
+const FlashState states[] PROGMEM = {
+	{"IDLE", 0, 0, nullptr, nullptr, nullptr, FlashState::MAX_TIME_COUNT, 0},
+	{"RUN", 400, 300, nullptr, nullptr, nullptr, FlashState::MAX_TIME_TRANSITION, ALARM},
+	{"ALARM", 0, 0, nullptr, nullptr, nullptr, FlashState::MAX_TIME_COUNT, 0},
+	{"WAIT", 0, 100, nullptr, nullptr, nullptr, FlashState::MAX_TIME_HANDLER, 0}
+};
+
+const FlashTransition transitions[] PROGMEM = {
+	{IDLE, RUN, &inStart, nullptr, 0},
+	{RUN, IDLE, &inReset, nullptr, 0},
+	{ALARM, WAIT, &inReset, nullptr, 0},
+	{WAIT, IDLE, nullptr, nullptr, 250}
+};
+
+const FlashAction actions[] PROGMEM = {
+	{RUN, Action::Type::D, &flashDelay, 50, 0},
+	{RUN, Action::Type::L, &flashLimit, 120, 0},
+	{ALARM, Action::Type::P, &flashPulse, 100, 20}
+};
+
+int main() {
+	FlashStateMachine empty(states, 0, transitions, 0);
+	empty.start();
+	CHECK(!empty.execute());
+
+	StateMachine ram;
+	State *stIdle = ram.addState("IDLE", nullptr);
+	State *stRun = ram.addState("RUN", 400, 300, nullptr);
+	State *stAlarm = ram.addState("ALARM", nullptr);
+	State *stWait = ram.addState("WAIT", 0, 100, nullptr);
+	stRun->setStateMaxTime(300, stAlarm);
+	stWait->setStateMaxTime(100, State::MAX_TIME_HANDLER);
+	stIdle->addTransition(stRun, inStart);
+	stRun->addTransition(stIdle, inReset);
+	stAlarm->addTransition(stWait, inReset);
+	stWait->addTransition(stIdle, 250);
+	stRun->addAction(Action::Type::D, ramDelay, 50);
+	stRun->addAction(Action::Type::L, ramLimit, 120);
+	stAlarm->addAction(Action::Type::P, ramPulse, 100)->setOnTime(20);
+	ram.setStallHandler(onRamStall);
+	ram.setInitialState(stIdle);
+	ram.start();
+
+	FlashStateMachine flash(states, transitions, actions);
+	flash.setStallHandler(onFlashStall);
+	flash.start();
+
+	bool alarm = false, delayed = false;
+	for (uint32_t tick = 0; tick < 3000; tick++) {
+		hostMillis++;
+		inStart = tick % 1000 == 10;
+		inReset = tick % 1000 == 700;
+
+		// D output reset by the application while RUN is active: not set again
+		if (ramDelay && flashDelay && tick % 1000 == 150) {
+			ramDelay = flashDelay = false;
+			delayed = true;
+		}
+
+		const bool ramChanged = ram.execute();
+		const bool flashChanged = flash.execute();
+		CHECK_EQ(ramChanged, flashChanged);
+		CHECK_EQ(ram.getActiveStateId(), flash.getCurrentState());
+		CHECK_EQ(ram.getCurrentState()->getTimeout(), flash.getTimeout());
+		CHECK_EQ(ramDelay, flashDelay);
+		CHECK_EQ(ramLimit, flashLimit);
+		CHECK_EQ(ramPulse, flashPulse);
+		alarm |= flash.getCurrentState() == ALARM;
+	}
+	CHECK(alarm && delayed);
+	CHECK_EQ(ramStalls, 3);
+	CHECK_EQ(flashStalls, 3);
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+* MachineLoader errors: a valid description is loaded, a bad transition kind, a time overflow, a truncated description
+* and bytes after the last action are refused without changing the machine.
+*/
+#include <vector>
+#include "MachineLoader.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static bool inGo, outRun;
+
+const MachineBinding bindings[] = {
+	{"inGo", inGo},
+	{"outRun", outRun}
+};
+
+// Two states, A -> B on inGo, B -> A after 300 ms, N action on outRun in B
+static std::vector<uint8_t> description() {
+	return {
+		'A', 'S', 'M', AGILE_MACHINE_FORMAT_VERSION,
+		2, 0,
+		'A', 0, 0, 0, 0, 0, 0,
+		'B', 0, 0, 0, 0, 0, 0,
+		2,
+		0, 1, Transition::ON_VARIABLE, 'i', 'n', 'G', 'o', 0,
+		1, 0, Transition::ON_TIMEOUT, 0xAC, 0x02,
+		1,
+		1, Action::Type::N, 'o', 'u', 't', 'R', 'u', 'n', 0, 0
+	};
+}
+
+static MachineLoader::Error load(const std::vector<uint8_t> &buffer, uint8_t &states) {
+	StateMachine fsm;
+	MachineLoader loader(bindings);
+	const MachineLoader::Error error = loader.load(fsm, buffer.data(), buffer.size());
+	states = fsm.GetStatesNumber();
+	return error;
+}
+
+int main() {
+	uint8_t states;
+	CHECK_EQ(load(description(), states), MachineLoader::LOAD_OK);
+	CHECK_EQ(states, 2);
+
+	std::vector<uint8_t> kind = description();
+	kind[23] = Transition::ON_EVENT;
+	CHECK_EQ(load(kind, states), MachineLoader::LOAD_BAD_VALUE);
+	CHECK_EQ(states, 0);
+
+	std::vector<uint8_t> overflow = description();
+	overflow[32] = 0xFF;
+	overflow.insert(overflow.begin() + 33, {0xFF, 0xFF, 0xFF, 0x1F});
+	CHECK_EQ(load(overflow, states), MachineLoader::LOAD_BAD_VALUE);
+
+	std::vector<uint8_t> truncated = description();
+	truncated.pop_back();
+	CHECK_EQ(load(truncated, states), MachineLoader::LOAD_TRUNCATED);
+
+	// Two descriptions concatenated, or one followed by garbage
+	std::vector<uint8_t> trailing = description();
+	trailing.push_back(0);
+	CHECK_EQ(load(trailing, states), MachineLoader::LOAD_TRAILING_DATA);
+	CHECK_EQ(states, 0);
+
+	std::vector<uint8_t> twice = description();
+	const std::vector<uint8_t> second = description();
+	twice.insert(twice.end(), second.begin(), second.end());
+	CHECK_EQ(load(twice, states), MachineLoader::LOAD_TRAILING_DATA);
+	return 0;
+}
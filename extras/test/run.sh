@@ -0,0 +1,37 @@
+#!/bin/sh
+# Host tests: each .cpp of this folder is a program built with the library sources and the Arduino shim of extras/host.
+# A test prints what it checks and exits with status 0 if all checks pass.
+#
+# usage: extras/test/run.sh [test ...]      (CXX and FLAGS to change compiler and flags, i.e. FLAGS=-DAGILE_SM_HEADER_ONLY)
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+SRC="$DIR/../../src"
+CXX=${CXX:-g++}
+OUT=$(mktemp -d)
+
+# With FLAGS=-fsanitize=address: states created by addState() are never freed (as on the boards), leaks are not errors
+export ASAN_OPTIONS=${ASAN_OPTIONS:-detect_leaks=0}
+
+if [ $# -eq 0 ]; then
+	set -- "$DIR"/*.cpp
+fi
+
+failed=0
+for test in "$@"; do
+	name=$(basename "$test" .cpp)
+	if ! $CXX -std=c++20 -O1 -Wall -Wextra -DAGILE_SM_CHECK_INVARIANTS $FLAGS -I"$DIR/../host" -I"$SRC" \
+		"$SRC"/*.cpp "$DIR/$name.cpp" -o "$OUT/$name"; then
+		echo "$name: build FAILED"
+		failed=1
+		continue
+	fi
+	if (cd "$OUT" && timeout 60 "./$name"); then
+		echo "$name: ok"
+	else
+		echo "$name: FAILED"
+		failed=1
+	fi
+done
+
+rm -rf "$OUT"
+exit $failed
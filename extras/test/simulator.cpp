@@ -0,0 +1,44 @@
+/*
+* Simulator with transitions triggered by outputs of the machine: an output written by the actions of a stable step
+* is seen by the transitions 1 ms later (N action on entry, D action when its time elapses), as when execute() runs every ms.
+*/
+#include <string>
+#include "Simulator.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+class StringPrint : public Print
+{
+public:
+	size_t write(uint8_t c) override {
+		text += (char)c;
+		return 1;
+	}
+	std::string text;
+};
+
+static bool outBusy, outDone;
+
+int main() {
+	StateMachine fsm;
+	State *stIdle = fsm.addState("IDLE", nullptr);
+	State *stRun = fsm.addState("RUN", nullptr);
+	stIdle->addTransition(stRun, outBusy);
+	stRun->addTransition(stIdle, outDone);
+	stIdle->addAction(Action::Type::N, outBusy);
+	stRun->addAction(Action::Type::D, outDone, 100);
+	fsm.setInitialState(stIdle);
+
+	StringPrint log;
+	Simulator sim(fsm);
+	sim.setLog(log);
+	const uint32_t transitions = sim.run(250);
+	CHECK_EQ(transitions, 5);
+	CHECK(log.text == "0 IDLE\n1 RUN\n103 IDLE\n104 RUN\n206 IDLE\n207 RUN\n");
+
+	// Write on change of the machine is restored
+	CHECK(!fsm.isWriteOnChange());
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+* Warm restart on host: the runtime of a machine is saved to a file (stand-in for EEPROM, RTC memory or NVS),
+* restored into a fresh machine after a "reset" (clock restarted) and both machines are then run side by side:
+* active state, elapsed time, timers and outputs must be the same at every tick.
+*/
+#include "AgileStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+// File used as non volatile memory of the snapshot
+class FileStore
+{
+public:
+	FileStore(const char *path) : m_path(path) {}
+
+	bool write(const uint8_t *buffer, size_t size) {
+		FILE *file = fopen(m_path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+		const bool written = fwrite(buffer, 1, size, file) == size;
+		return fclose(file) == 0 && written;
+	}
+
+	size_t read(uint8_t *buffer, size_t size) {
+		FILE *file = fopen(m_path, "rb");
+		if (file == nullptr) {
+			return 0;
+		}
+		const size_t len = fread(buffer, 1, size, file);
+		fclose(file);
+		return len;
+	}
+
+private:
+	const char *m_path;
+};
+
+struct Machine
+{
+	StateMachine fsm;
+	bool inStart = false;
+	bool outLimited = false, outDelayed = false, outRunning = false, outHold = false;
+	uint16_t outWord = 0;
+
+	void setup() {
+		State *stIdle = fsm.addState("Idle", nullptr);
+		State *stRun = fsm.addState("Run", nullptr);
+		State *stHold = fsm.addState("Hold", 100, nullptr);
+
+		stIdle->addTransition(stRun, inStart);
+		stRun->addTransition(stHold, 2000);
+		stHold->addTransition(stIdle, 1000);
+
+		stRun->addAction(Action::Type::L, outLimited, 300);
+		stRun->addAction(Action::Type::D, outDelayed, 500);
+		stRun->addAction(Action::Type::N, outRunning);
+		stRun->addAction(Action::Type::D, outWord, 0x0001, 800);
+		stRun->addAction(Action::Type::L, outWord, 0x0002, 200);
+		stHold->addAction(Action::Type::S, outHold);
+		stIdle->addAction(Action::Type::R, outHold);
+
+		fsm.setInitialState(stIdle);
+		fsm.start();
+	}
+};
+
+// Machine a runs with the clock ahead of offset
+static void checkSame(Machine &a, Machine &b, uint32_t offset) {
+	CHECK_EQ(a.fsm.getActiveStateId(), b.fsm.getActiveStateId());
+	CHECK_EQ(a.outLimited, b.outLimited);
+	CHECK_EQ(a.outDelayed, b.outDelayed);
+	CHECK_EQ(a.outRunning, b.outRunning);
+	CHECK_EQ(a.outHold, b.outHold);
+	CHECK_EQ(a.outWord, b.outWord);
+	const uint32_t deadline = b.fsm.getNextDeadline();
+	hostMillis += offset;
+	CHECK_EQ(a.fsm.getNextDeadline(), deadline);
+	hostMillis -= offset;
+}
+
+// Save the snapshot of machine in the middle of state Run (L action expired, D actions still timing)
+static void checkRoundTrip(uint32_t saveAt) {
+	FileStore store("snapshot.bin");
+	Machine before;
+	hostMillis = 123456;
+	before.setup();
+	hostMillis += 10;
+	before.inStart = true;
+	CHECK(before.fsm.execute());
+	before.inStart = false;
+	const uint32_t runStart = hostMillis;
+	while (hostMillis - runStart < saveAt) {
+		hostMillis++;
+		before.fsm.execute();
+	}
+
+	uint8_t buffer[128];
+	const size_t len = before.fsm.saveSnapshot(buffer, sizeof(buffer));
+	CHECK(len > 0);
+	CHECK(len <= before.fsm.getSnapshotSize());
+	CHECK(store.write(buffer, len));
+
+	// Reset: the clock restarts and the machine is built again from its definition
+	const uint32_t elapsed = hostMillis - runStart;
+	hostMillis = 7;
+	Machine after;
+	after.setup();
+	uint8_t loaded[128];
+	const size_t loadedLen = store.read(loaded, sizeof(loaded));
+	CHECK_EQ(loadedLen, len);
+	CHECK(after.fsm.restoreSnapshot(loaded, loadedLen));
+	CHECK_EQ(hostMillis - after.fsm.getCurrentState()->getEnterTime(), elapsed);
+
+	// The original machine continues on its own clock: same outputs at the same time in state
+	const uint32_t offset = runStart + elapsed - hostMillis;
+	checkSame(before, after, offset);
+	for (uint32_t tick = 0; tick < 4000; tick++) {
+		hostMillis++;
+		const uint32_t now = hostMillis;
+		after.fsm.execute();
+		hostMillis = now + offset;
+		before.fsm.execute();
+		hostMillis = now;
+		checkSame(before, after, offset);
+	}
+
+	// A corrupted snapshot is refused without touching the machine
+	loaded[len / 2] ^= 0x10;
+	const uint8_t active = after.fsm.getActiveStateId();
+	CHECK(!after.fsm.restoreSnapshot(loaded, len));
+	CHECK_EQ(after.fsm.getActiveStateId(), active);
+	remove("snapshot.bin");
+}
+
+int main() {
+	checkRoundTrip(0);
+	checkRoundTrip(150);     // L and D timing
+	checkRoundTrip(350);     // L expired, D timing
+	checkRoundTrip(900);     // D executed
+	return 0;
+}
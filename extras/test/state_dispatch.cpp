@@ -0,0 +1,94 @@
+/*
+* Handlers of StateImpl classes: execute<States...>() must call the same handlers, in the same order, of execute()
+* (classes listed and not listed, states with callback functions, events published on entry).
+*/
+#include <string>
+#include "StateImpl.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static std::string calls;
+
+class Fill : public StateImpl<Fill>
+{
+public:
+	Fill() : StateImpl("FILL") {}
+	void onEnter() { calls += "F+"; }
+	void onExit() { calls += "F-"; }
+	void onRun() { calls += "f"; }
+	bool isFull() { return getEnterTime() + 30 <= hostMillis; }
+};
+
+class Drain : public StateImpl<Drain>
+{
+public:
+	Drain() : StateImpl("DRAIN", 5) {}
+	void onExit() { calls += "D-"; }
+};
+
+class Rest : public StateImpl<Rest>
+{
+public:
+	Rest() : StateImpl("REST", 10) {}
+	void onRun() { calls += "r"; }
+};
+
+static void onAlarm() { calls += "A+"; }
+static void onAlarmRun() { calls += "a"; }
+
+struct Machine
+{
+	StateMachine fsm;
+	EventBus bus;
+	Fill stFill;
+	Drain stDrain;
+	Rest stRest;
+	bool inAlarm = false;
+
+	void setup() {
+		fsm.addState(stFill);
+		fsm.addState(stDrain);
+		fsm.addState(stRest);
+		State *stAlarm = fsm.addState("ALARM", onAlarm, nullptr, onAlarmRun);
+
+		stFill.addTransition<&Fill::isFull>(&stDrain);
+		stFill.addTransition(stAlarm, inAlarm);
+		stDrain.addTransition(&stRest, 20);
+		stRest.addTransition(&stFill, AgileEvent(1));     // Published on entry of DRAIN
+		stAlarm->addTransition(&stFill, 15);
+		stDrain.emitOnEnter(bus, AgileEvent(1));
+		bus.subscribe(fsm);
+
+		fsm.setInitialState(stFill);
+		fsm.start();
+	}
+};
+
+int main() {
+	Machine generic, typed;
+	generic.setup();
+	typed.setup();
+
+	std::string genericCalls, typedCalls;
+	for (uint32_t tick = 0; tick < 2000; tick++) {
+		hostMillis++;
+		generic.inAlarm = typed.inAlarm = (tick % 170) == 0;
+
+		calls.clear();
+		const bool genericChanged = generic.fsm.execute();
+		genericCalls += calls;
+
+		calls.clear();
+		const bool typedChanged = typed.fsm.execute<Fill, Drain>();     // Rest and ALARM handled as by execute()
+		typedCalls += calls;
+
+		CHECK_EQ(genericChanged, typedChanged);
+		CHECK_EQ(generic.fsm.getActiveStateId(), typed.fsm.getActiveStateId());
+	}
+	CHECK(genericCalls == typedCalls);
+	CHECK(genericCalls.find("F+") != std::string::npos && genericCalls.find("A+") != std::string::npos);
+	CHECK(genericCalls.find("D-") != std::string::npos && genericCalls.find('r') != std::string::npos);
+	return 0;
+}
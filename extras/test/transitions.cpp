@@ -0,0 +1,86 @@
+/*
+* Order of transitions: sorted by priority (stable) when the machine starts, all the conflicts reported
+* also when the handler walks the transitions of the state, round robin with a limit of transitions per tick.
+*/
+#include "AgileStateMachine.h"
+#include "check.h"
+
+uint32_t hostMillis = 0;
+Print Serial;
+
+static bool inA, inB, inC, inD;
+static uint8_t conflicts;
+static State *lastOther;
+
+static char evaluated[16];
+static uint8_t evaluations;
+
+template <char N>
+static bool guard() {
+	evaluated[evaluations++ % (sizeof(evaluated) - 1)] = N;
+	return N == 'z' && inD;
+}
+
+static void onConflict(State *state, Transition *taken, Transition *other) {
+	// The handler can inspect the state (it moves the iterator of the list)
+	for (uint8_t i = 0; i < state->getTransitionsNumber(); i++) {
+		CHECK(state->getTransition(i) != nullptr);
+	}
+	CHECK(taken != other);
+	lastOther = other->getOutputState();
+	conflicts++;
+}
+
+int main() {
+	StateMachine fsm;
+	State *stIdle = fsm.addState("IDLE", nullptr);
+	State *stA = fsm.addState("A", nullptr);
+	State *stB = fsm.addState("B", nullptr);
+	State *stC = fsm.addState("C", nullptr);
+	State *stD = fsm.addState("D", nullptr);
+	stIdle->addTransition(stA, inA);
+	stIdle->addTransition(stB, inB)->setPriority(5);
+	stIdle->addTransition(stC, inC);
+	stIdle->addTransition(stD, inD)->setPriority(5);
+	fsm.setInitialState(stIdle);
+	fsm.setConflictHandler(onConflict);
+	fsm.start();
+
+	// Stable sort: B, D (priority 5), then A, C
+	CHECK(stIdle->getTransition(0)->getOutputState() == stB);
+	CHECK(stIdle->getTransition(1)->getOutputState() == stD);
+	CHECK(stIdle->getTransition(2)->getOutputState() == stA);
+	CHECK(stIdle->getTransition(3)->getOutputState() == stC);
+
+	inA = inB = inC = inD = true;
+	hostMillis++;
+	CHECK(fsm.execute());
+	CHECK(fsm.getCurrentState() == stB);
+	CHECK_EQ(conflicts, 3);
+	CHECK(lastOther == stC);
+
+	// Two transitions for each tick, resuming from the next one (also after the state is inspected)
+	StateMachine budget;
+	State *stWait = budget.addState("WAIT", nullptr);
+	State *stDone = budget.addState("DONE", nullptr);
+	stWait->addTransition(stDone, guard<'x'>);
+	stWait->addTransition(stDone, guard<'y'>);
+	stWait->addTransition(stDone, guard<'z'>);
+	budget.setInitialState(stWait);
+	budget.setTransitionsPerTick(2);
+	budget.start();
+
+	inD = false;
+	for (uint8_t tick = 0; tick < 4; tick++) {
+		hostMillis++;
+		CHECK(!budget.execute());
+		CHECK(stWait->getTransition(2) != nullptr);
+	}
+	CHECK(strcmp(evaluated, "xyzxyzxy") == 0);
+
+	inD = true;
+	hostMillis++;
+	CHECK(budget.execute());
+	CHECK(budget.getCurrentState() == stDone);
+	return 0;
+}
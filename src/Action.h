@@ -2,6 +2,7 @@
 #ifndef AGILE_ACTION_H
 #define AGILE_ACTION_H
 #include "Arduino.h"
+#include "Clock.h"
 #pragma once
 class State;
 
@@ -16,7 +17,8 @@ public:
 		L,
 		D,
 		RE,
-		FE
+		FE,
+		P
 	};
 
 	~Action(){};
@@ -24,11 +26,46 @@ public:
 	Action(State *state, uint8_t type, bool *target, uint32_t time = 0)
 		: m_state(state), m_actionType(type), m_actionTarget(target), m_delay(time) {}
 
+	// Statically allocated action, state is assigned by State::addAction()
+	Action(uint8_t type, bool &target, uint32_t time = 0)
+		: m_actionType(type), m_actionTarget(&target), m_delay(time) {}
+
 	State *getState() const { return m_state; }
 	uint8_t getType() const { return m_actionType; }
 	uint32_t getDelay() const { return m_delay; }
 	bool *getTarget() const { return m_actionTarget; }
 
+	// Time the target of a P action is TRUE in each period (default half period)
+	Action *setOnTime(uint32_t time)
+	{
+		m_onTime = time;
+		return this;
+	}
+	uint32_t getOnTime() const { return m_onTime ? m_onTime : m_delay / 2; }
+
+	// True if the timer of L, D or P action is running
+	bool isTiming() const { return m_edge && !m_done && (m_actionType == Type::L || m_actionType == Type::D || m_actionType == Type::P); }
+
+	// Time left before the timer of L, D or P action changes the target (UINT32_MAX if nothing pending)
+	uint32_t getTimeToDeadline(uint32_t now) const
+	{
+		if (!isTiming())
+			return UINT32_MAX;
+		if (m_actionType == Type::P)
+		{
+			if (m_delay == 0 || getOnTime() >= m_delay)
+				return UINT32_MAX;
+			const uint32_t phase = (now - m_time) % m_delay;
+			if (*m_actionTarget != (phase < getOnTime()))
+				return 0;
+			return phase < getOnTime() ? getOnTime() - phase : m_delay - phase;
+		}
+		if (m_actionType == Type::L ? !*m_actionTarget : *m_actionTarget)
+			return UINT32_MAX;
+		uint32_t elapsed = now - m_time;
+		return elapsed > m_delay ? 0 : m_delay - elapsed + 1;
+	}
+
 	void clear()
 	{
 		switch (m_actionType)
@@ -37,9 +74,10 @@ public:
 		case Type::L:
 		case Type::D:
 		case Type::RE:
+		case Type::P:
 			*m_actionTarget = false;
 			m_edge = false;
-			m_time = -1;
+			m_done = false;
 			break;
 
 		// Falling Edge
@@ -50,6 +88,12 @@ public:
 	}
 
 	void execute()
+	{
+		execute(AgileClock::now());
+	}
+
+	// Same as execute(), but with the time of current tick already read by the engine
+	void execute(uint32_t now)
 	{
 		switch (m_actionType)
 		{
@@ -76,11 +120,10 @@ public:
 			if (!m_edge)
 			{
 				*m_actionTarget = true;
-				m_time = millis();
+				m_time = now;
 				m_edge = true;
 			}
-
-			if ((millis() - m_time) > m_delay && m_edge && m_time > 0)
+			else if (now - m_time > m_delay)
 			{
 				*m_actionTarget = false;
 			}
@@ -91,15 +134,14 @@ public:
 		case Type::D:
 			if (!m_edge)
 			{
-				m_time = millis();
+				m_time = now;
 				m_edge = true;
 				*m_actionTarget = false;
 			}
-
-			if ((millis() - m_time) > m_delay && m_edge && m_time > 0)
+			else if (!m_done && now - m_time > m_delay)
 			{
 				*m_actionTarget = true;
-				m_time = -1; // Action executed
+				m_done = true; // Action executed
 			}
 			break;
 
@@ -114,18 +156,38 @@ public:
 				*m_actionTarget = true;
 			}
 			break;
+
+		// Pulse:
+		// target variable TRUE for the on time at the start of each period (FALSE on state exit)
+		case Type::P:
+			if (!m_edge)
+			{
+				m_time = now;
+				m_edge = true;
+			}
+			else if (m_delay > 0 && now - m_time >= m_delay)
+			{
+				// Start of current period (the division is needed only when a period has ended)
+				const uint32_t elapsed = now - m_time;
+				m_time += elapsed - elapsed % m_delay;
+			}
+			*m_actionTarget = m_delay == 0 || now - m_time < getOnTime();
+			break;
 		}
 	}
 
 protected:
-	int32_t m_time = -1; // Last call time of Action (-1 not called)
-	bool m_edge = false;
-	Action *m_nextAction = nullptr;
+	friend class State;
+	friend class StateMachine;
+	uint32_t m_time = 0; // Start time of L and D actions, start of current period of P actions (valid when m_edge is set)
+	bool m_edge = false; // Action started since the state was entered
+	bool m_done = false; // D action executed (target is set once)
 
 	State *m_state = nullptr;
-	uint8_t m_actionType; // The type of action  { 'N', 'S', 'R', 'L', 'D'}
+	uint8_t m_actionType; // The type of action  { 'N', 'S', 'R', 'L', 'D', 'RE', 'FE', 'P'}
 	bool *m_actionTarget; // The variable wich is affected by action
-	uint32_t m_delay;	  // For L - limited time and D - delayed actions
+	uint32_t m_delay;	  // For L - limited time and D - delayed actions, period of P - pulse actions
+	uint32_t m_onTime = 0; // For P - pulse actions (0 = half period)
 };
 
 #endif
\ No newline at end of file
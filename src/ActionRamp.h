@@ -0,0 +1,112 @@
+#ifndef AGILE_ACTION_RAMP_H
+#define AGILE_ACTION_RAMP_H
+#include "Arduino.h"
+#pragma once
+
+// Type of the value driven by ramps (i.e. servo angle or PWM duty)
+#ifndef AGILE_RAMP_T
+#define AGILE_RAMP_T int16_t
+#endif
+
+using ramp_t = AGILE_RAMP_T;
+
+// Products of a distance by 1000 or of a time by a rate: 32 bits are enough for 8 and 16 bit values, wider ones need 64 bits
+template <bool Wide>
+struct RampCalc
+{
+	using type = uint32_t;
+};
+
+template <>
+struct RampCalc<true>
+{
+	using type = uint64_t;
+};
+
+using ramp_calc_t = RampCalc<(sizeof(ramp_t) > 2)>::type;
+
+/*
+* Ramp of an integer target toward a setpoint, with a rate in units per second.
+* The value is computed from the time elapsed since the state was entered (no timer of its own), starting from
+* the value the target has on the first run of the state. On state exit the target keeps its value.
+*/
+class ActionRamp
+{
+public:
+	~ActionRamp(){};
+
+	ActionRamp(ramp_t &target, ramp_t setpoint, uint32_t rate)
+		: m_target(&target), m_setpoint(setpoint), m_rate(rate) {}
+
+	ramp_t *getTarget() const { return m_target; }
+	ramp_t getSetpoint() const { return m_setpoint; }
+	uint32_t getRate() const { return m_rate; }
+
+	// True when the target has reached the setpoint
+	bool isDone() const { return m_started && *m_target == m_setpoint; }
+
+	void clear()
+	{
+		m_started = false;
+	}
+
+	// Time left before the target changes by one unit (UINT32_MAX if the ramp is done)
+	uint32_t getTimeToDeadline(uint32_t elapsed) const
+	{
+		if (!m_started)
+			return 0;
+		if (*m_target == m_setpoint || m_rate == 0)
+			return UINT32_MAX;
+
+		// Time of the next step from the value of target
+		const ramp_calc_t steps = distance(*m_target, m_from) + 1;
+		const ramp_calc_t next = (steps * 1000 + m_rate - 1) / m_rate;
+		const uint32_t time = elapsed - m_start;
+		if (next <= time)
+			return 0;
+		return (next - time < UINT32_MAX) ? (uint32_t)(next - time) : UINT32_MAX;
+	}
+
+	void execute(uint32_t elapsed)
+	{
+		if (!m_started)
+		{
+			m_from = *m_target;
+			m_start = elapsed;
+			m_started = true;
+		}
+
+		// Distance is at most the range of ramp_t, so time * rate can't overflow ramp_calc_t before the end of the ramp
+		const ramp_calc_t total = distance(m_setpoint, m_from);
+		const uint32_t time = elapsed - m_start;
+		if (m_rate == 0 || time >= (total * 1000) / m_rate)
+		{
+			*m_target = m_setpoint;
+			return;
+		}
+
+		const ramp_calc_t steps = (ramp_calc_t)time * m_rate / 1000;
+		*m_target = (m_setpoint > m_from) ? (ramp_t)(m_from + steps) : (ramp_t)(m_from - steps);
+	}
+
+protected:
+	// Distance between two values (computed in unsigned arithmetic, so the difference of signed values can't overflow)
+	static ramp_calc_t distance(ramp_t a, ramp_t b)
+	{
+		return (a > b) ? (ramp_calc_t)a - (ramp_calc_t)b : (ramp_calc_t)b - (ramp_calc_t)a;
+	}
+
+	friend class State;
+	friend class StateMachine;
+	ActionRamp *m_next = nullptr; // Next ramp driven by the same state
+
+	ramp_t *m_target;
+	ramp_t m_setpoint;
+	uint32_t m_rate;    // Units per second (0 = setpoint at once)
+
+	ramp_t m_from = 0;  // Value of target on the first run
+	uint32_t m_start = 0;
+	bool m_started = false;
+};
+
+#endif
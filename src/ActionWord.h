@@ -0,0 +1,111 @@
+#ifndef AGILE_ACTION_WORD_H
+#define AGILE_ACTION_WORD_H
+#include "Arduino.h"
+#include "Action.h"
+#pragma once
+
+// Size of the output word driven by bit-packed actions (i.e. uint8_t for an AVR port register image)
+#ifndef AGILE_ACTION_WORD_T
+#define AGILE_ACTION_WORD_T uint16_t
+#endif
+
+using action_word_t = AGILE_ACTION_WORD_T;
+
+class OutputSink;
+
+/*
+* Bit-packed actions: each bit of a user provided output word is a target.
+* All the actions of a state on the same word are stored as one mask for each action type,
+* and the L/D/P timers are shared by the state (elapsed time since the state was entered).
+*/
+class ActionWord
+{
+public:
+	~ActionWord(){};
+
+	ActionWord(action_word_t &target) : m_target(&target) {}
+
+	action_word_t *getTarget() const { return m_target; }
+
+	// Add the bits of mask to the actions of given type (time is shared by all L, all D or all P bits):
+	// false if the time differs from the preset of the bits of the same type already added
+	bool addAction(uint8_t type, action_word_t mask, uint32_t time = 0)
+	{
+		if ((type == Action::Type::L && m_l && m_lTime != time) || (type == Action::Type::D && m_d && m_dTime != time)
+			|| (type == Action::Type::P && m_p && m_pTime != time))
+			return false;
+
+		switch (type)
+		{
+		case Action::Type::N:  m_n |= mask;  break;
+		case Action::Type::S:  m_s |= mask;  break;
+		case Action::Type::R:  m_r |= mask;  break;
+		case Action::Type::L:  m_l |= mask;  m_lTime = time; break;
+		case Action::Type::D:  m_d |= mask;  m_dTime = time; break;
+		case Action::Type::RE: m_re |= mask; break;
+		case Action::Type::FE: m_fe |= mask; break;
+		case Action::Type::P:  m_p |= mask;  m_pTime = time; break;
+		}
+		return true;
+	}
+
+	// Clear N, L, D, RE and P bits, set FE bits (on state exit)
+	void clear()
+	{
+		*m_target = (*m_target & ~(m_n | m_l | m_d | m_re | m_p)) | m_fe;
+	}
+
+	// Time left before L, D or P bits change (UINT32_MAX if nothing pending)
+	uint32_t getTimeToDeadline(uint32_t elapsed) const
+	{
+		uint32_t deadline = UINT32_MAX;
+		if (m_l && elapsed <= m_lTime)
+			deadline = m_lTime - elapsed + 1;
+		if (m_d && elapsed <= m_dTime)
+			deadline = min(deadline, m_dTime - elapsed + 1);
+		if (m_p && m_pTime > 1)
+		{
+			const uint32_t phase = elapsed % m_pTime;
+			const action_word_t expected = (phase < m_pTime / 2) ? m_p : 0;
+			if ((*m_target & m_p) != expected)
+				return 0;
+			deadline = min(deadline, expected ? m_pTime / 2 - phase : m_pTime - phase);
+		}
+		return deadline;
+	}
+
+	// Update all the bits of word at once
+	void execute(uint32_t elapsed, bool firstRun)
+	{
+		action_word_t word = (*m_target | m_n | m_s) & ~m_r;
+
+		// Time limited: TRUE until the end of the set time
+		word = (elapsed <= m_lTime) ? (word | m_l) : (word & ~m_l);
+
+		// Time delayed: TRUE after the set time has elapsed
+		word = (elapsed > m_dTime) ? (word | m_d) : (word & ~m_d);
+
+		// Rising edge: TRUE only on first run after state is activated
+		word = firstRun ? (word | m_re) : (word & ~m_re);
+
+		// Pulse: TRUE in the first half of each period
+		if (m_p)
+			word = (m_pTime < 2 || elapsed % m_pTime < m_pTime / 2) ? (word | m_p) : (word & ~m_p);
+
+		*m_target = word;
+	}
+
+protected:
+	friend class State;
+	friend class StateMachine;
+	ActionWord *m_next = nullptr; // Next word driven by the same state
+	OutputSink *m_sink = nullptr; // Flushed after the word is updated (if target is the image of a sink)
+
+	action_word_t *m_target;
+	action_word_t m_n = 0, m_s = 0, m_r = 0, m_l = 0, m_d = 0, m_re = 0, m_fe = 0, m_p = 0;
+	uint32_t m_lTime = 0;
+	uint32_t m_dTime = 0;
+	uint32_t m_pTime = 0;
+};
+
+#endif
@@ -1,110 +1,589 @@
 #include "AgileStateMachine.h"
+#include "TimerWheel.h"
+#include "StateGroup.h"
 
-void StateMachine::addState(State &state) {
+// Data and weak handlers are defined only here, also in header-only builds
+#ifndef AGILE_SM_IMPLEMENTATION
+clock_cb AgileClock::s_source = nullptr;
+
+#ifdef AGILE_SM_CHECK_INVARIANTS
+__attribute__((weak)) void agileInvariantFailed(const __FlashStringHelper *what) {
+	(void)what;
+	abort();
+}
+#endif
+#endif
+
+#if !defined(AGILE_SM_HEADER_ONLY) || defined(AGILE_SM_IMPLEMENTATION)
+AGILE_SM_INLINE StateMachine::~StateMachine() {
+	if (m_events != nullptr) {
+		m_events->m_bus->unsubscribe(*this);
+	}
+	clearIndex();
+	delete m_changes;
+	if (m_timer != nullptr) {
+		if (m_timer->link != nullptr) {
+			m_timer->wheel->cancel(m_timer);
+		}
+		delete m_timer;
+	}
+}
+
+
+AGILE_SM_INLINE void StateMachine::addState(State &state) {
 	state.setIndex(m_states.size());
 	m_states.append(&state);
 	m_currentState = &state;
 }
 
 
-void StateMachine::start() {
+#ifdef AGILE_SM_NO_NAMES
+AGILE_SM_INLINE State *StateMachine::addUnnamedState(uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run) {
+	State *state = new State(State::NoName(), min, max, enter, exit, run);
+	addState(*state);
+	return state;
+}
+#endif
+
+
+AGILE_SM_INLINE void StateMachine::start() {
+	buildIndex();
+	if (m_events != nullptr) {
+		m_events->m_mask = getEventMask();
+	}
+
+	// Transitions are evaluated in order of priority
+	for (uint8_t i = 0; i < m_states.size(); i++) {
+		getState(i)->sortTransitions();
+	}
+
+	// Dwell times of initial state are measured from start
+	if (m_currentState == nullptr) {
+		return;
+	}
+	const uint32_t now = AgileClock::now();
+	enterState(m_currentState, now);
 	m_started = true;
+	updateTimer(now);
 }
 
 
-void StateMachine::stop() {
+AGILE_SM_INLINE void StateMachine::stop() {
 	m_started = false;
+	updateTimer(AgileClock::now());
 }
 
 
-bool StateMachine::execute() {
+AGILE_SM_INLINE bool StateMachine::execute() {
+	return executeWith<StateDispatch<>>();
+}
+
 
+AGILE_SM_INLINE uint32_t StateMachine::getNextDeadline() {
 	if (!m_started) {
-		return false;
+		return UINT32_MAX;
 	}
+	return m_currentState->getTimeToDeadline(AgileClock::now());
+}
 
-	for (State *state = m_states.first(); state != nullptr; state = m_states.next()) {
 
-		if (state == m_currentState) {
+// Keep the nearest deadline of active state in the timer wheel (cancelled if there is nothing to wait)
+AGILE_SM_INLINE void StateMachine::updateTimer(uint32_t now) {
+	if (m_timer == nullptr) {
+		return;
+	}
 
-			if (m_currentState->m_minTime > 0) {
-				if (millis() - m_currentState->m_enterTime < m_currentState->m_minTime)	{
-					continue;
-				}
-			}
+	const uint32_t deadline = m_started ? m_currentState->getTimeToDeadline(now) : UINT32_MAX;
+	if (deadline == UINT32_MAX) {
+		m_timer->wheel->cancel(m_timer);
+	}
+	else {
+		m_timer->wheel->schedule(m_timer, now + deadline);
+	}
+}
+
+
+AGILE_SM_INLINE void StateMachine::leaveState(bool callOnLeaving, uint32_t now) {
+	const uint32_t stay = now - m_currentState->m_enterTime;
+	if (stay > m_currentState->m_longestStay) {
+		m_currentState->m_longestStay = stay;
+	}
 
-			// Check triggers for current state
-			State *m_nextState = state->runTransitions();
+	// Last state of the group (and its elapsed time) is saved for the history
+	if (m_currentState->m_group != nullptr) {
+		m_currentState->m_group->save(m_currentState, stay);
+	}
 
-			// One of the transitions has triggered, set the new state
-			if (m_nextState != nullptr) {
+	// Clear the actions before exit actual state
+	m_currentState->clearActions(m_changes);
+	AGILE_SM_CHECK(m_currentState->actionsCleared(), "Outputs not cleared on exit");
 
-				// Clear the actions before exit actual state
-				if (m_currentState->getActions()){
-					m_currentState->clearActions();
-				}
+	// Call current state OnLeaving() callback function
+	if (callOnLeaving) {
+		m_currentState->callOnLeaving();
+	}
+}
 
-				// Call current state OnLeaving() callback function
-				if (m_currentState->m_onLeaving != nullptr) {
-					m_currentState->m_onLeaving();
-				}
 
-				// Set new state
-				m_currentState = m_nextState;
-				m_currentState->m_enterTime = millis();
-				m_currentState->m_timeout = false;
+AGILE_SM_INLINE bool StateMachine::isStalled() const {
+	return m_started && m_currentState->m_timeout;
+}
 
-				// Call actual state OnEntering() callback function
-				if (m_currentState->m_onEntering != nullptr) {
-					m_currentState->m_onEntering();
-				}
 
-				return true;
-			}
+AGILE_SM_INLINE uint32_t StateMachine::getViolations() {
+	uint32_t total = 0;
+	for (uint8_t i = 0; i < m_states.size(); i++) {
+		total += getState(i)->m_violations;
+	}
+	return total;
+}
+
+
+AGILE_SM_INLINE void StateMachine::resetHealth() {
+	for (uint8_t i = 0; i < m_states.size(); i++) {
+		getState(i)->resetHealth();
+	}
+}
+
+
+// One line for each state: "name max <ms> longest <ms> violations <n>", the active state with its current stay
+AGILE_SM_INLINE void StateMachine::printHealth(Print &out) {
+	const uint32_t now = AgileClock::now();
+	for (uint8_t i = 0; i < m_states.size(); i++) {
+		State *state = getState(i);
+		uint32_t longest = state->m_longestStay;
+		const bool active = m_started && state == m_currentState;
+		if (active && now - state->m_enterTime > longest) {
+			longest = now - state->m_enterTime;
+		}
+
+		state->printName(out);
+		out.print(F(" max "));
+		out.print(state->m_maxTime);
+		out.print(F(" longest "));
+		out.print(longest);
+		out.print(F(" violations "));
+		out.print(state->m_violations);
+		if (active && state->m_timeout) {
+			out.print(F(" (stalled)"));
 		}
+		out.println();
 	}
+}
+
 
-	// Run callback function while FSM remain in actual state
-	if (m_currentState->m_onRunning != nullptr) {
-		m_currentState->m_onRunning();
+// State added to this machine (and still at its index)
+AGILE_SM_INLINE bool StateMachine::isOwnState(State *state) {
+	return state != nullptr && getState(state->getIndex()) == state;
+}
+
+
+AGILE_SM_INLINE void StateMachine::enterState(State *state, uint32_t now) {
+	// History of a group: enter the last active state of group (with elapsed time in RESUME_TIME mode)
+	uint32_t enterTime = now;
+	if (state->m_isHistory) {
+		state = state->m_group->resume(now, enterTime);
+	}
+
+	AGILE_SM_CHECK(isOwnState(state), "State not in machine");
+	m_currentState = state;
+	m_currentState->m_enterTime = enterTime;
+	m_currentState->m_timeout = false;
+	m_currentState->m_firstRun = true;
+	m_currentState->m_nextTransition = nullptr;
+	m_currentState->m_actionsDue = 0;
+}
+
+
+AGILE_SM_INLINE void StateMachine::setWriteOnChange(bool enable) {
+	if (enable && m_changes == nullptr) {
+		m_changes = new OutputChanges;
+	}
+	else if (!enable) {
+		delete m_changes;
+		m_changes = nullptr;
+	}
+}
+
+
+// Remove from the set the outputs changed and restored in the same tick
+AGILE_SM_INLINE void StateMachine::compactChanges() {
+	if (m_changes == nullptr) {
+		return;
 	}
 
-	// Run actions for current state (ALL types if defined)
-	if (m_currentState->getActions()){
-		m_currentState->runActions();
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < m_changes->count; i++) {
+		if (*m_changes->target[i] != m_changes->before[i]) {
+			m_changes->target[count] = m_changes->target[i];
+			m_changes->before[count++] = m_changes->before[i];
+		}
 	}
+	m_changes->count = count;
+}
+
 
-	return false;
+AGILE_SM_INLINE bool StateMachine::isChanged(const bool &output) const {
+	for (uint8_t i = 0; i < getChangedCount(); i++) {
+		if (m_changes->target[i] == &output) {
+			return true;
+		}
+	}
+	return isChangeOverflow();
 }
 
 
-State* StateMachine::getCurrentState() {
+AGILE_SM_INLINE State* StateMachine::getCurrentState() {
 	return m_currentState;
 }
 
 
-int StateMachine::GetStatesNumber() {
+AGILE_SM_INLINE State* StateMachine::getState(uint8_t index) {
+	if (index >= m_states.size()) {
+		return nullptr;
+	}
+	if (m_indexSize == m_states.size()) {
+		return m_stateIndex[index];
+	}
+	return m_states.get(index);
+}
+
+
+#ifndef AGILE_SM_NO_NAMES
+// Read a char of name (stored in RAM or flash)
+static inline char nameChar(const char *name, bool flash, size_t i) {
+	return flash ? (char)pgm_read_byte(name + i) : name[i];
+}
+
+// FNV-1a hash (16 bit folded) of state name
+static inline uint16_t nameHash(const char *name, bool flash) {
+	uint32_t hash = 2166136261UL;
+	for (size_t i = 0; nameChar(name, flash, i) != '\0'; i++) {
+		hash = (hash ^ (uint8_t)nameChar(name, flash, i)) * 16777619UL;
+	}
+	return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+static inline bool sameName(const char *a, bool aFlash, const char *b, bool bFlash) {
+	for (size_t i = 0; ; i++) {
+		char c = nameChar(a, aFlash, i);
+		if (c != nameChar(b, bFlash, i)) {
+			return false;
+		}
+		if (c == '\0') {
+			return true;
+		}
+	}
+}
+#endif
+
+
+AGILE_SM_INLINE void StateMachine::clearIndex() {
+	delete[] m_stateIndex;
+	m_stateIndex = nullptr;
+#ifndef AGILE_SM_NO_NAMES
+	delete[] m_nameIndex;
+	m_nameIndex = nullptr;
+#endif
+	m_indexSize = 0;
+}
+
+
+AGILE_SM_INLINE void StateMachine::buildIndex() {
+	clearIndex();
+	const uint8_t count = m_states.size();
+	if (count == 0) {
+		return;
+	}
+
+	m_stateIndex = new State*[count];
+#ifndef AGILE_SM_NO_NAMES
+	m_nameIndex = new NameHash[count];
+#endif
+	uint8_t i = 0;
+	for (State *state = m_states.first(); state != nullptr; state = m_states.next(), i++) {
+		m_stateIndex[i] = state;
+
+#ifndef AGILE_SM_NO_NAMES
+		// Insertion sort by hash of name
+		NameHash item = {0, i};
+		if (state->getStateName() != nullptr) {
+			item.hash = nameHash(state->getStateName(), state->isNameInFlash());
+		}
+		uint8_t pos = i;
+		while (pos > 0 && m_nameIndex[pos - 1].hash > item.hash) {
+			m_nameIndex[pos] = m_nameIndex[pos - 1];
+			pos--;
+		}
+		m_nameIndex[pos] = item;
+#endif
+	}
+	m_indexSize = count;
+}
+
+
+#ifndef AGILE_SM_NO_NAMES
+AGILE_SM_INLINE State* StateMachine::findState(const char *name) {
+	return findState(name, false);
+}
+
+
+AGILE_SM_INLINE State* StateMachine::findState(const __FlashStringHelper *name) {
+	return findState(reinterpret_cast<const char *>(name), true);
+}
+
+
+AGILE_SM_INLINE State* StateMachine::findState(const char *name, bool flash) {
+	if (name == nullptr) {
+		return nullptr;
+	}
+	if (m_indexSize != m_states.size()) {
+		buildIndex();
+	}
+
+	// Binary search of the first item with same hash, then compare names (hash collisions)
+	const uint16_t hash = nameHash(name, flash);
+	uint8_t low = 0, high = m_indexSize;
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+		if (m_nameIndex[mid].hash < hash) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	for (; low < m_indexSize && m_nameIndex[low].hash == hash; low++) {
+		State *state = m_stateIndex[m_nameIndex[low].index];
+		if (state->getStateName() != nullptr
+			&& sameName(name, flash, state->getStateName(), state->isNameInFlash())) {
+			return state;
+		}
+	}
+	return nullptr;
+}
+#endif
+
+
+// Events that trigger the transitions of the machine (only these are queued by the bus)
+AGILE_SM_INLINE uint32_t StateMachine::getEventMask() {
+	uint32_t mask = 0;
+	for (uint8_t i = 0; i < m_states.size(); i++) {
+		State *state = m_states.get(i);
+		for (uint8_t t = 0; t < state->getTransitionsNumber(); t++) {
+			const int16_t event = state->getTransition(t)->getTriggerEvent();
+			if (event >= 0 && event < 32) {
+				mask |= 1UL << event;
+			}
+		}
+	}
+	return mask;
+}
+
+
+AGILE_SM_INLINE int StateMachine::GetStatesNumber() {
 	return m_states.size();
 }
 
 
-uint32_t StateMachine::getLastEnterTime() {
+AGILE_SM_INLINE uint32_t StateMachine::getLastEnterTime() {
 	return m_currentState->getEnterTime();
 }
 
-void StateMachine::setCurrentState(State *newState, bool callOnEntering, bool callOnLeaving) {
-	// Guarantee that will run OnLeaving()
-	if (m_currentState->m_onLeaving != nullptr && callOnLeaving)
-		m_currentState->m_onLeaving();
+AGILE_SM_INLINE void StateMachine::setCurrentState(State *newState, bool callOnEntering, bool callOnLeaving) {
+	// Same exit sequence of execute(): actions cleared, then OnLeaving()
+	const uint32_t now = AgileClock::now();
+	if (m_currentState != nullptr) {
+		leaveState(callOnLeaving, now);
+	}
 
-	// Update current machine state
-	m_currentState = newState;
+	// Update Enter Time before OnEntering(), as done by execute()
+	enterState(newState, now);
 
 	// Guarantee that will run OnEntering()
-	if (m_currentState->m_onEntering != nullptr && callOnEntering)
-		m_currentState->m_onEntering();
+	if (callOnEntering)
+		m_currentState->callOnEntering();
 
-	// Update Enter Time
-	m_currentState->m_enterTime = millis();
-	m_currentState->m_timeout = false;
+	updateTimer(now);
+}
+
+
+/*
+* Snapshot binary format (little endian):
+* version, number of states, active state index, flags (started, timeout, first run), elapsed time (4 bytes),
+* value of each ActionWord target, one byte for each Action (target, edge, timer running, D executed),
+* time elapsed since the start of each running timer of active state actions (4 bytes each), checksum.
+*/
+enum SnapshotMachineFlags : uint8_t {
+	SNAP_STARTED = 0x01,
+	SNAP_TIMEOUT = 0x02,
+	SNAP_FIRST_RUN = 0x04
+};
+
+enum SnapshotActionFlags : uint8_t {
+	SNAP_ACTION_TARGET = 0x01,
+	SNAP_ACTION_EDGE = 0x02,
+	SNAP_ACTION_TIMER = 0x04,
+	SNAP_ACTION_DONE = 0x08
+};
+
+static const size_t SNAP_HEADER_SIZE = 8;
+
+static inline void putU32(uint8_t *buffer, size_t &pos, uint32_t value) {
+	for (uint8_t i = 0; i < 4; i++) {
+		buffer[pos++] = value >> (8 * i);
+	}
+}
+
+static inline uint32_t getU32(const uint8_t *buffer, size_t &pos) {
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < 4; i++) {
+		value |= (uint32_t)buffer[pos++] << (8 * i);
+	}
+	return value;
+}
+
+static inline uint8_t snapshotChecksum(const uint8_t *buffer, size_t size) {
+	uint8_t sum = 0;
+	for (size_t i = 0; i < size; i++) {
+		sum = ((sum << 1) | (sum >> 7)) ^ buffer[i];
+	}
+	return sum;
+}
+
+
+AGILE_SM_INLINE size_t StateMachine::getSnapshotSize() {
+	size_t size = SNAP_HEADER_SIZE + 1;
+	for (State *state = m_states.first(); state != nullptr; state = m_states.next()) {
+		for (ActionWord *word = state->m_actionWords; word != nullptr; word = word->m_next) {
+			size += sizeof(action_word_t);
+		}
+		size += state->m_actions.size();
+		if (state == m_currentState) {
+			size += 4 * state->m_actions.size();
+		}
+	}
+	return size;
+}
+
+
+AGILE_SM_INLINE size_t StateMachine::saveSnapshot(uint8_t *buffer, size_t size) {
+	if (m_currentState == nullptr || size < getSnapshotSize()) {
+		return 0;
+	}
+
+	const uint32_t now = AgileClock::now();
+	size_t pos = 0;
+	buffer[pos++] = AGILE_SNAPSHOT_VERSION;
+	buffer[pos++] = m_states.size();
+	buffer[pos++] = m_currentState->m_stateIndex;
+	buffer[pos++] = (m_started ? SNAP_STARTED : 0) | (m_currentState->m_timeout ? SNAP_TIMEOUT : 0)
+				  | (m_currentState->m_firstRun ? SNAP_FIRST_RUN : 0);
+	putU32(buffer, pos, now - m_currentState->m_enterTime);
+
+	for (State *state = m_states.first(); state != nullptr; state = m_states.next()) {
+		for (ActionWord *word = state->m_actionWords; word != nullptr; word = word->m_next) {
+			for (uint8_t i = 0; i < sizeof(action_word_t); i++) {
+				buffer[pos++] = *word->m_target >> (8 * i);
+			}
+		}
+
+		if (state->m_actions.size() == 0) {
+			continue;
+		}
+		for (Action *action = state->m_actions.first(); action != nullptr; action = state->m_actions.next()) {
+			buffer[pos++] = (*action->m_actionTarget ? SNAP_ACTION_TARGET : 0) | (action->m_edge ? SNAP_ACTION_EDGE : 0)
+						  | (state == m_currentState && action->isTiming() ? SNAP_ACTION_TIMER : 0)
+						  | (action->m_done ? SNAP_ACTION_DONE : 0);
+		}
+	}
+
+	// Timers of the actions in active state
+	if (m_currentState->m_actions.size()) {
+		for (Action *action = m_currentState->m_actions.first(); action != nullptr; action = m_currentState->m_actions.next()) {
+			if (action->isTiming()) {
+				putU32(buffer, pos, now - action->m_time);
+			}
+		}
+	}
+
+	buffer[pos] = snapshotChecksum(buffer, pos);
+	return pos + 1;
+}
+
+
+AGILE_SM_INLINE bool StateMachine::restoreSnapshot(const uint8_t *buffer, size_t size) {
+	if (size < SNAP_HEADER_SIZE + 1 || buffer[0] != AGILE_SNAPSHOT_VERSION
+		|| buffer[1] != m_states.size() || buffer[2] >= m_states.size()) {
+		return false;
+	}
+	if (snapshotChecksum(buffer, size - 1) != buffer[size - 1]) {
+		return false;
+	}
+
+	// Check the size expected for this machine before changing anything
+	State *active = nullptr;
+	size_t pos = SNAP_HEADER_SIZE;
+	size_t timers = 0;
+	for (State *state = m_states.first(); state != nullptr; state = m_states.next()) {
+		for (ActionWord *word = state->m_actionWords; word != nullptr; word = word->m_next) {
+			pos += sizeof(action_word_t);
+		}
+		if (state->m_stateIndex == buffer[2]) {
+			active = state;
+		}
+		for (int i = 0; i < state->m_actions.size(); i++, pos++) {
+			if (pos < size && (buffer[pos] & SNAP_ACTION_TIMER)) {
+				timers++;
+			}
+		}
+	}
+	if (active == nullptr || pos + 4 * timers + 1 != size) {
+		return false;
+	}
+
+	const uint32_t now = AgileClock::now();
+	pos = 3;
+	const uint8_t flags = buffer[pos++];
+	const uint32_t elapsed = getU32(buffer, pos);
+
+	for (State *state = m_states.first(); state != nullptr; state = m_states.next()) {
+		for (ActionWord *word = state->m_actionWords; word != nullptr; word = word->m_next) {
+			action_word_t value = 0;
+			for (uint8_t i = 0; i < sizeof(action_word_t); i++) {
+				value |= (action_word_t)buffer[pos++] << (8 * i);
+			}
+			*word->m_target = value;
+		}
+
+		if (state->m_actions.size() == 0) {
+			continue;
+		}
+		for (Action *action = state->m_actions.first(); action != nullptr; action = state->m_actions.next()) {
+			*action->m_actionTarget = buffer[pos] & SNAP_ACTION_TARGET;
+			action->m_edge = buffer[pos] & SNAP_ACTION_EDGE;
+			action->m_done = buffer[pos] & SNAP_ACTION_DONE;
+			pos++;
+		}
+	}
+
+	if (active->m_actions.size()) {
+		for (Action *action = active->m_actions.first(); action != nullptr; action = active->m_actions.next()) {
+			if (action->isTiming()) {
+				action->m_time = now - getU32(buffer, pos);
+			}
+		}
+	}
+
+	m_currentState = active;
+	m_currentState->m_enterTime = now - elapsed;
+	m_currentState->m_timeout = flags & SNAP_TIMEOUT;
+	m_currentState->m_firstRun = flags & SNAP_FIRST_RUN;
+	m_currentState->m_actionsDue = 0;
+	m_currentState->m_nextTransition = nullptr;
+	m_started = flags & SNAP_STARTED;
+	updateTimer(now);
+	return true;
 }
+#endif
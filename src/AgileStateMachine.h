@@ -9,47 +9,70 @@
 #include "LinkedList.h"
 #include "State.h"
 
+// Version of the binary format used by saveSnapshot()/restoreSnapshot()
+#define AGILE_SNAPSHOT_VERSION 1
+
+// Runtime checks of the engine invariants, for debug builds and host tests (add -DAGILE_SM_CHECK_INVARIANTS to build flags)
+#ifdef AGILE_SM_CHECK_INVARIANTS
+// Called when an invariant is broken (default calls abort(), define it in the application to report the error)
+void agileInvariantFailed(const __FlashStringHelper *what);
+#define AGILE_SM_CHECK(cond, what) do { if (!(cond)) agileInvariantFailed(F(what)); } while (0)
+#else
+#define AGILE_SM_CHECK(cond, what)
+#endif
+
 using state_cb = void (*)();
 
+class TimerWheel;
+struct WheelTimer;
+
 /// @brief
 class StateMachine
 {
 public:
 	// Default constructor/destructor
 	StateMachine(){};
-	~StateMachine(){};
+	~StateMachine();
+
+	// The machine owns its lookup tables (and timer node): copies would free them twice
+	StateMachine(const StateMachine &) = delete;
+	StateMachine &operator=(const StateMachine &) = delete;
 
 	// Add a new state to the list of states
 	template <typename T>
-	State *addState(T name, uint32_t min, uint32_t max, state_cb enter = nullptr, state_cb exit = nullptr, state_cb run = nullptr)
+	AGILE_SM_NAME_INLINE State *addState(T name, uint32_t min, uint32_t max, state_cb enter = nullptr, state_cb exit = nullptr, state_cb run = nullptr)
 	{
+#ifndef AGILE_SM_NO_NAMES
 		State *state = new State(name, min, max, enter, exit, run);
-		state->setIndex(m_states.size());
-		m_states.append(state);
-		m_currentState = state;
+		addState(*state);
 		return state;
+#else
+		(void)name;
+		return addUnnamedState(min, max, enter, exit, run);
+#endif
 	}
 
+	// Name is a pointer (RAM or F() string): objects of classes derived from State use addState(State &state)
 	template <typename T>
-	State *addState(T name)
+	AGILE_SM_NAME_INLINE State *addState(T *name)
 	{
 		return addState(name, 0, 0, nullptr, nullptr, nullptr);
 	}
 
 	template <typename T>
-	State *addState(T name, uint32_t min, uint32_t max)
+	AGILE_SM_NAME_INLINE State *addState(T name, uint32_t min, uint32_t max)
 	{
 		return addState(name, min, max, nullptr, nullptr, nullptr);
 	}
 
 	template <typename T>
-	State *addState(T name, uint32_t min, state_cb enter = nullptr, state_cb exit = nullptr, state_cb run = nullptr)
+	AGILE_SM_NAME_INLINE State *addState(T name, uint32_t min, state_cb enter = nullptr, state_cb exit = nullptr, state_cb run = nullptr)
 	{
 		return addState(name, min, 0, enter, exit, run);
 	}
 
 	template <typename T>
-	State *addState(T name, state_cb enter = nullptr, state_cb exit = nullptr, state_cb run = nullptr)
+	AGILE_SM_NAME_INLINE State *addState(T name, state_cb enter, state_cb exit = nullptr, state_cb run = nullptr)
 	{
 		return addState(name, 0, 0, enter, exit, run);
 	}
@@ -61,6 +84,7 @@ public:
 
 	// Sets the initial state.
 	void setInitialState(State *state) { m_currentState = state; }
+	void setInitialState(State &state) { m_currentState = &state; }
 
 	// Start the State Machine
 	void start();
@@ -71,35 +95,250 @@ public:
 	// Returns the numbers of states added to State Machine
 	int GetStatesNumber();
 
-	// Returns the name of the currently active state as const char*
+	// Returns the name of the currently active state as const char*. With AGILE_SM_NO_NAMES it's the ID as text in a buffer
+	// shared by all the states, overwritten by the next call: use getCurrentState()->printName(out) to print it
 	const char *getActiveStateName()
 	{
 		return m_currentState->getStateName();
 	}
 
 	// Returns the name of the currently active state as pointer to flash string helper - F() macro
+#ifndef AGILE_SM_NO_NAMES
 	const __FlashStringHelper *getActiveStateName_P()
+#else
+	const char *getActiveStateName_P()
+#endif
 	{
 		return m_currentState->getStateName_P();
 	}
 
+	// ID of the currently active state (index in the order states were added)
+	uint8_t getActiveStateId()
+	{
+		return m_currentState->getIndex();
+	}
+
 	// Return information about the current state of the database. This is a pointer to the pager state
 	State *getCurrentState();
 
+	// Returns the state with given index (in the order states were added), nullptr if not exist
+	State *getState(uint8_t index);
+
+#ifndef AGILE_SM_NO_NAMES
+	// Returns the state with given name (RAM or F() string), nullptr if not exist
+	State *findState(const char *name);
+	State *findState(const __FlashStringHelper *name);
+#endif
+
+	// Build the lookup tables used by getState() and findState() (done also by start())
+	void buildIndex();
+
 	// Run the state machine
 	bool execute();
 
+	// Same as execute(), with the handlers of the StateImpl classes listed called directly (see StateImpl.h)
+	template <class... States>
+	bool execute()
+	{
+		return executeWith<StateDispatch<States...>>();
+	}
+
 	// Return the last enter time in nanoseconds
 	uint32_t getLastEnterTime();
 
+	// Size in bytes needed to store the snapshot of machine runtime
+	size_t getSnapshotSize();
+
+	// Serialize the runtime (active state, elapsed time, actions) in buffer: returns the bytes written (0 if buffer is too small)
+	size_t saveSnapshot(uint8_t *buffer, size_t size);
+
+	// Restore the runtime from a snapshot created with saveSnapshot() (false if not valid for this machine)
+	bool restoreSnapshot(const uint8_t *buffer, size_t size);
+
+	// Milliseconds until the next timed event of current state (min/max time, timed transitions)
+	// UINT32_MAX if the current state has nothing to wait for
+	uint32_t getNextDeadline();
+
+	// Debug mode: all transitions of active state are evaluated and handler is called when more than one triggers (nullptr to disable)
+	void setConflictHandler(conflict_cb handler) { m_onConflict = handler; }
+
+	// Called once when a state with policy MAX_TIME_HANDLER stays active beyond its max time (it must not change the state)
+	void setStallHandler(stall_cb handler) { m_onStall = handler; }
+
+	// Active state is beyond its max time (timeout flagged and not left yet)
+	bool isStalled() const;
+
+	// Health report: max time violations of all states, clear the counters, print the stats of each state
+	uint32_t getViolations();
+	void resetHealth();
+	void printHealth(Print &out);
+
+	// Actions evaluated only on state entry/exit and timers expiry, and set of outputs changed by each execute()
+	void setWriteOnChange(bool enable);
+	bool isWriteOnChange() const { return m_changes != nullptr; }
+
+	// Outputs (bool targets of actions) changed by last execute() (always 0 without write on change)
+	uint8_t getChangedCount() const { return m_changes != nullptr ? m_changes->count : 0; }
+	bool *getChangedOutput(uint8_t index) const { return index < getChangedCount() ? m_changes->target[index] : nullptr; }
+	bool isChanged(const bool &output) const;
+
+	// More outputs changed than AGILE_SM_CHANGED_OUTPUTS: check all of them
+	bool isChangeOverflow() const { return m_changes != nullptr && m_changes->overflow; }
+
+	// Evaluate at most count transitions for each execute(), resuming from the next one at the following call (0 = all)
+	void setTransitionsPerTick(uint8_t count) { m_transitionsPerTick = count; }
+
+	// Max events of the queue handled by each execute(), until one of them triggers a transition (default 1)
+	void setEventsPerTick(uint8_t count) { m_eventsPerTick = count > 0 ? count : 1; }
+
+	// Event handled by last execute() (nullptr if none): valid in the callbacks of the states
+	const EventMessage *getEvent() const { return m_hasEvent ? &m_event : nullptr; }
+
+	// Queue of events (nullptr if the machine is not subscribed to an EventBus)
+	EventQueue *getEventQueue() const { return m_events; }
+
 private:
 	friend class Action;
 	friend class State;
 	friend class Transition;
+	friend class TimerWheel;
+	friend class EventBus;
+
+	template <class Dispatch>
+	bool executeWith();
+	void enterState(State *state, uint32_t now);
+	void updateTimer(uint32_t now);
+	void compactChanges();
+	void leaveState(bool callOnLeaving, uint32_t now);
+	bool isOwnState(State *state);
+	uint32_t getEventMask();
+
+#ifdef AGILE_SM_NO_NAMES
+	// Add a state without name (the call left by the inline addState())
+	State *addUnnamedState(uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run);
+#endif
+
+#ifndef AGILE_SM_NO_NAMES
+	struct NameHash {
+		uint16_t hash;
+		uint8_t index;
+	};
+
+	State *findState(const char *name, bool flash);
+#endif
+	void clearIndex();
 
 	bool m_started = false;
 	State *m_currentState = nullptr;
 	LinkedList<State *> m_states;
+
+	conflict_cb m_onConflict = nullptr;
+	stall_cb m_onStall = nullptr;
+	uint8_t m_transitionsPerTick = 0;
+	OutputChanges *m_changes = nullptr;
+
+	// Queue of events from an EventBus (nullptr if not subscribed) and event handled by last execute()
+	EventQueue *m_events = nullptr;
+	EventMessage m_event;
+	bool m_hasEvent = false;
+	uint8_t m_eventsPerTick = 1;
+
+	// Deadline of active state in a TimerWheel (nullptr if not used)
+	WheelTimer *m_timer = nullptr;
+
+	// Lookup tables: states by index and (hash of name, index) sorted by hash
+	State **m_stateIndex = nullptr;
+#ifndef AGILE_SM_NO_NAMES
+	NameHash *m_nameIndex = nullptr;
+#endif
+	uint8_t m_indexSize = 0;
 };
 
+// Body of execute(), with the calls of state handlers made by Dispatch
+template <class Dispatch>
+inline bool StateMachine::executeWith() {
+	if (!m_started) {
+		return false;
+	}
+
+	if (m_changes != nullptr) {
+		m_changes->count = 0;
+		m_changes->overflow = false;
+	}
+
+	// Read the time once, all dwell and transition timers are evaluated against it
+	const uint32_t now = AgileClock::now();
+	const uint32_t elapsed = now - m_currentState->m_enterTime;
+	State *nextState = nullptr;
+
+	// Max time elapsed: flag and count the violation once per activation, then apply the policy of the state
+	if (m_currentState->m_maxTime > 0 && elapsed >= m_currentState->m_maxTime) {
+		if (!m_currentState->m_timeout) {
+			m_currentState->m_timeout = true;
+			if (m_currentState->m_violations < UINT16_MAX) {
+				m_currentState->m_violations++;
+			}
+			if (m_currentState->m_maxTimePolicy == State::MAX_TIME_HANDLER && m_onStall != nullptr) {
+				m_onStall(m_currentState, elapsed);
+			}
+		}
+		if (m_currentState->m_maxTimePolicy == State::MAX_TIME_TRANSITION) {
+			nextState = m_currentState->m_timeoutState;
+		}
+	}
+
+	// Min time not elapsed: transitions are not evaluated (and events remain queued), but state is still active
+	Transition *taken = nullptr;
+	m_hasEvent = false;
+	if (nextState == nullptr && elapsed >= m_currentState->m_minTime) {
+		if (m_events != nullptr && !m_events->isEmpty()) {
+			// Events in order of arrival: all the transitions are evaluated with each one (handled or discarded),
+			// the event remains queued for the next state if a transition not triggered by events is taken
+			for (uint8_t n = 0; n < m_eventsPerTick && taken == nullptr && m_events->peek(m_event); n++) {
+				taken = m_currentState->runTransitions(now, m_onConflict, 0, m_event.id);
+				if (taken == nullptr || taken->m_event >= 0) {
+					m_events->pop(m_event);
+					m_hasEvent = true;
+				}
+			}
+		}
+		else {
+			taken = m_currentState->runTransitions(now, m_onConflict, m_transitionsPerTick);
+		}
+		nextState = (taken != nullptr) ? taken->getOutputState() : nullptr;
+	}
+
+	// One of the transitions has triggered, set the new state
+	if (nextState != nullptr) {
+		leaveState(false, now);
+		Dispatch::exit(m_currentState);
+		if (taken != nullptr && taken->m_emitBus != nullptr) {
+			taken->m_emitBus->publish(AgileEvent(taken->m_emitEvent), taken->m_emitPayload);
+		}
+
+		// Set new state (or the one resumed by a history) and call OnEntering() callback function
+		enterState(nextState, now);
+		Dispatch::enter(m_currentState);
+		compactChanges();
+		updateTimer(now);
+		return true;
+	}
+
+	// Run callback function while FSM remain in actual state
+	Dispatch::run(m_currentState);
+
+	// Run actions for current state (ALL types if defined)
+	m_currentState->runActions(now, elapsed, m_changes);
+	compactChanges();
+	updateTimer(now);
+
+	return false;
+}
+
+#ifdef AGILE_SM_HEADER_ONLY
+#define AGILE_SM_IMPLEMENTATION
+#include "AgileStateMachine.cpp"
+#undef AGILE_SM_IMPLEMENTATION
+#endif
+
 #endif
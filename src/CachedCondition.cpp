@@ -0,0 +1,4 @@
+#include "CachedCondition.h"
+
+// Starts from 1, so a condition never evaluated (stamp 0) is not valid
+uint32_t CachedCondition::s_tick = 1;
@@ -0,0 +1,60 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_CACHED_CONDITION_H
+#define AGILE_CACHED_CONDITION_H
+#include "Arduino.h"
+#include "Clock.h"
+
+using condition_cb = bool (*)();
+
+/*
+* Condition evaluated at most once per tick, however many transitions (of one or more machines) use it.
+* The cached value is valid for the time (millisecond) of the execute() that reads it, so with plain execute()
+* the condition is evaluated again at least every millisecond. CachedCondition::nextTick() starts a new tick
+* also in the same millisecond: call it once at the beginning of loop() to read the inputs at every loop
+* (MachineRunner, TimerWheel and Simulator advance it by themselves).
+*/
+class CachedCondition
+{
+public:
+	explicit CachedCondition(condition_cb condition) : m_condition(condition) {}
+
+	// Value in this tick (the callback is called only on the first request)
+	bool get() { return get(AgileClock::now()); }
+
+	// Same as get(), with the time of current tick already read by the engine
+	bool get(uint32_t now) {
+		if (m_stamp != s_tick || m_time != now) {
+			m_value = m_condition();
+			m_stamp = s_tick;
+			m_time = now;
+			m_calls++;
+		}
+		return m_value;
+	}
+
+	// Evaluate again on the next request (i.e. when an action has changed what the condition reads)
+	void invalidate() { m_stamp = s_tick - 1; }
+
+	condition_cb getCallback() const { return m_condition; }
+
+	// Number of times the callback was called
+	uint32_t getCalls() const { return m_calls; }
+
+	// New tick: all the cached values are discarded
+	static void nextTick() { s_tick++; }
+	static uint32_t getTick() { return s_tick; }
+
+private:
+	condition_cb m_condition;
+	uint32_t m_stamp = 0;
+	uint32_t m_time = 0;
+	uint32_t m_calls = 0;
+	bool m_value = false;
+
+	static uint32_t s_tick;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef AGILE_CLOCK_H
+#define AGILE_CLOCK_H
+#include "Arduino.h"
+#pragma once
+
+using clock_cb = uint32_t (*)();
+
+// Time source (milliseconds) of all the state machines: millis() or a virtual clock (i.e. for simulation)
+class AgileClock
+{
+public:
+	static uint32_t now() { return s_source != nullptr ? s_source() : millis(); }
+
+	// Set the function used as time source (nullptr to get back to millis())
+	static void setSource(clock_cb source) { s_source = source; }
+
+private:
+	static clock_cb s_source;
+};
+
+#endif
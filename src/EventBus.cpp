@@ -0,0 +1,99 @@
+#include "EventBus.h"
+#include "AgileStateMachine.h"
+
+bool EventQueue::push(uint8_t id, const void *payload) {
+	if (m_count == m_size) {
+		m_dropped++;
+		return false;
+	}
+	EventMessage &message = m_items[(m_head + m_count) % m_size];
+	message.id = id;
+	message.payload = payload;
+	m_count++;
+	return true;
+}
+
+
+bool EventQueue::peek(EventMessage &message) const {
+	if (m_count == 0) {
+		return false;
+	}
+	message = m_items[m_head];
+	return true;
+}
+
+
+bool EventQueue::pop(EventMessage &message) {
+	if (m_count == 0) {
+		return false;
+	}
+	message = m_items[m_head];
+	m_head = (m_head + 1 < m_size) ? m_head + 1 : 0;
+	m_count--;
+	return true;
+}
+
+
+EventBus::~EventBus() {
+	while (m_queues != nullptr) {
+		EventQueue *queue = m_queues;
+		m_queues = queue->m_next;
+		queue->m_fsm->m_events = nullptr;
+		delete queue;
+	}
+}
+
+
+void EventBus::subscribe(StateMachine &fsm, uint8_t size) {
+	if (fsm.m_events != nullptr || size == 0) {
+		return;
+	}
+
+	EventQueue *queue = new EventQueue(&fsm, this, size);
+	queue->m_mask = fsm.getEventMask();
+	fsm.m_events = queue;
+
+	EventQueue **last = &m_queues;
+	while (*last != nullptr) {
+		last = &(*last)->m_next;
+	}
+	*last = queue;
+}
+
+
+void EventBus::unsubscribe(StateMachine &fsm) {
+	for (EventQueue **link = &m_queues; *link != nullptr; link = &(*link)->m_next) {
+		EventQueue *queue = *link;
+		if (queue->m_fsm == &fsm) {
+			*link = queue->m_next;
+			fsm.m_events = nullptr;
+			delete queue;
+			return;
+		}
+	}
+}
+
+
+bool EventBus::publish(AgileEvent event, const void *payload) {
+	AGILE_SM_CHECK(event.id < 32, "Event id out of range");
+	if (event.id >= 32) {
+		return false;
+	}
+
+	bool queued = true;
+	for (EventQueue *queue = m_queues; queue != nullptr; queue = queue->m_next) {
+		if (queue->m_mask & (1UL << event.id)) {
+			queued &= queue->push(event.id, payload);
+		}
+	}
+	return queued;
+}
+
+
+uint16_t EventBus::getDropped() const {
+	uint16_t dropped = 0;
+	for (EventQueue *queue = m_queues; queue != nullptr; queue = queue->m_next) {
+		dropped += queue->m_dropped;
+	}
+	return dropped;
+}
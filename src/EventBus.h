@@ -0,0 +1,94 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_EVENT_BUS_H
+#define AGILE_EVENT_BUS_H
+#include "Arduino.h"
+
+// Default number of events queued for each subscribed machine
+#ifndef AGILE_SM_EVENT_QUEUE
+#define AGILE_SM_EVENT_QUEUE 4
+#endif
+
+class StateMachine;
+class EventBus;
+
+// Identifier of an event (0..31): used to publish it and as trigger of transitions
+struct AgileEvent
+{
+	constexpr explicit AgileEvent(uint8_t eventId) : id(eventId) {}
+	uint8_t id;
+};
+
+// Event in a queue: the payload is passed by pointer (not copied), it must be valid until the event is handled
+struct EventMessage
+{
+	uint8_t id;
+	const void *payload;
+};
+
+// Fixed size FIFO of events for one machine (allocated once by EventBus::subscribe())
+class EventQueue
+{
+public:
+	~EventQueue() { delete[] m_items; }
+
+	uint8_t getCount() const { return m_count; }
+	bool isEmpty() const { return m_count == 0; }
+
+	// Events lost because the queue was full
+	uint16_t getDropped() const { return m_dropped; }
+
+private:
+	friend class EventBus;
+	friend class StateMachine;
+
+	EventQueue(StateMachine *fsm, EventBus *bus, uint8_t size) : m_items(new EventMessage[size]), m_size(size), m_fsm(fsm), m_bus(bus) {}
+
+	bool push(uint8_t id, const void *payload);
+	bool peek(EventMessage &message) const;
+	bool pop(EventMessage &message);
+
+	EventMessage *m_items;
+	uint8_t m_size;
+	uint8_t m_head = 0;
+	uint8_t m_count = 0;
+	uint16_t m_dropped = 0;
+	uint32_t m_mask = 0;    // Events used by the transitions of the machine (the others are not queued)
+	StateMachine *m_fsm;
+	EventBus *m_bus;        // Bus of the queue (the machine unsubscribes when destroyed)
+	EventQueue *m_next = nullptr;
+};
+
+/*
+* Publish/subscribe of events between machines (and from the application).
+* Each subscribed machine has its own queue: an event published is queued, in the order of publication,
+* only for the machines that have transitions triggered by it. Each execute() handles at most the events
+* set with StateMachine::setEventsPerTick() (default 1), while the state waits its min time events remain queued.
+* An event is left in the queue when a transition not triggered by events is taken (it's handled by the next state).
+* Not safe from interrupts. A subscribed machine can be destroyed before the bus (its queue is removed),
+* but transitions and states that publish on the bus must not be executed after the bus is destroyed.
+*/
+class EventBus
+{
+public:
+	~EventBus();
+
+	// Allocate the queue of machine (size events)
+	void subscribe(StateMachine &fsm, uint8_t size = AGILE_SM_EVENT_QUEUE);
+
+	// Remove the queue of machine (done also by the destructor of the machine)
+	void unsubscribe(StateMachine &fsm);
+
+	// Queue the event for the machines waiting for it (false if a queue was full and the event is lost for that machine)
+	bool publish(AgileEvent event, const void *payload = nullptr);
+
+	// Events lost because of full queues
+	uint16_t getDropped() const;
+
+private:
+	EventQueue *m_queues = nullptr;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "Executive.h"
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		const uint32_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+
+// Interrupts off while the pending ticks are updated (a 32 bit access is not atomic on AVR).
+// On AVR the previous state is restored, so it can be used also in tick() called from an interrupt.
+class InterruptLock
+{
+public:
+#ifdef __AVR__
+	InterruptLock() : m_sreg(SREG) { cli(); }
+	~InterruptLock() { SREG = m_sreg; }
+private:
+	uint8_t m_sreg;
+#else
+	InterruptLock() { noInterrupts(); }
+	~InterruptLock() { interrupts(); }
+#endif
+};
+
+
+uint32_t Executive::now() {
+#ifdef __linux__
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#else
+	return micros();
+#endif
+}
+
+
+bool Executive::addGroup(uint32_t period, StateMachine *const *machines, uint8_t count) {
+	if (m_groupsCount == AGILE_EXEC_GROUPS || period == 0) {
+		return false;
+	}
+
+	// Faster groups first (executed before the slower ones released in the same tick)
+	uint8_t pos = m_groupsCount;
+	while (pos > 0 && m_groups[pos - 1].period > period) {
+		m_groups[pos] = m_groups[pos - 1];
+		pos--;
+	}
+	RateGroup &group = m_groups[pos];
+	group.machines = machines;
+	group.count = count;
+	group.period = period;
+	m_groupsCount++;
+
+	m_base = gcd(m_base, period);
+	for (uint8_t i = 0; i < m_groupsCount; i++) {
+		m_groups[i].divider = m_groups[i].period / m_base;
+	}
+	resetStats();
+
+	// Release times restart from the next poll() or tick()
+	m_started = false;
+	return true;
+}
+
+
+void Executive::resetStats() {
+	for (uint8_t i = 0; i < m_groupsCount; i++) {
+		m_groups[i].runs = 0;
+		m_groups[i].overruns = 0;
+		m_groups[i].maxJitter = 0;
+		m_groups[i].maxDuration = 0;
+	}
+}
+
+
+void Executive::start() {
+	begin(now());
+}
+
+
+void Executive::begin(uint32_t time) {
+	m_start = time;
+	m_nextTick = m_start + m_base;
+	m_ticks = 0;
+	for (uint8_t i = 0; i < m_groupsCount; i++) {
+		m_groups[i].countdown = m_groups[i].divider;
+		m_groups[i].release = m_start + m_groups[i].period;
+	}
+	InterruptLock lock;
+	m_pending = 0;
+	m_started = true;
+}
+
+
+uint8_t Executive::poll() {
+	if (m_groupsCount == 0) {
+		return 0;
+	}
+	if (!m_started) {
+		start();
+	}
+
+	const uint32_t time = now();
+	uint32_t ticks = 0;
+	while ((int32_t)(time - m_nextTick) >= 0) {
+		m_nextTick += m_base;
+		ticks++;
+	}
+	return ticks > 0 ? advance(ticks) : 0;
+}
+
+
+uint8_t Executive::tick() {
+	if (m_groupsCount == 0) {
+		return 0;
+	}
+	if (!m_started) {
+		// The first call is the first tick: time 0 is one base period before
+		begin(now() - m_base);
+	}
+	return advance(1);
+}
+
+
+uint8_t Executive::advance(uint32_t ticks) {
+	// Timer faster than the groups: the ticks are handled by the call in progress
+	{
+		InterruptLock lock;
+		if (m_busy) {
+			m_pending = m_pending + ticks;
+			return 0;
+		}
+		m_busy = true;
+	}
+
+	uint8_t executed = 0;
+	for (;;) {
+		m_ticks += ticks;
+
+		// Releases counted down for each group (no division of the tick count, that wraps around)
+		for (uint8_t i = 0; i < m_groupsCount; i++) {
+			RateGroup &group = m_groups[i];
+			if (ticks < group.countdown) {
+				group.countdown -= ticks;
+				continue;
+			}
+			const uint32_t late = ticks - group.countdown;
+			const uint32_t releases = 1 + late / group.divider;
+			group.countdown = group.divider - late % group.divider;
+
+			// Only the last release is executed, the previous ones are lost
+			if (releases > 1) {
+				group.overruns += releases - 1;
+			}
+			const uint32_t release = group.release + (releases - 1) * group.period;
+			group.release = release + group.period;
+
+			// A run before its release time (timer a bit early) has no delay
+			const uint32_t start = now();
+			const int32_t jitter = (int32_t)(start - release);
+			if (jitter > 0 && (uint32_t)jitter > group.maxJitter) {
+				group.maxJitter = jitter;
+			}
+
+			CachedCondition::nextTick();
+			for (uint8_t m = 0; m < group.count; m++) {
+				group.machines[m]->execute();
+			}
+
+			const uint32_t duration = now() - start;
+			if (duration > group.maxDuration) {
+				group.maxDuration = duration;
+			}
+			group.runs++;
+			executed++;
+		}
+
+		// Ticks added meanwhile by the timer, read and cleared together
+		InterruptLock lock;
+		ticks = m_pending;
+		m_pending = 0;
+		if (ticks == 0) {
+			m_busy = false;
+			return executed;
+		}
+	}
+}
+
+
+#ifdef __linux__
+uint32_t Executive::runFor(uint32_t duration) {
+	if (m_groupsCount == 0) {
+		return 0;
+	}
+
+	const int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if (fd < 0) {
+		return 0;
+	}
+
+	struct itimerspec spec;
+	spec.it_interval.tv_sec = m_base / 1000000UL;
+	spec.it_interval.tv_nsec = (m_base % 1000000UL) * 1000;
+	spec.it_value = spec.it_interval;
+	start();
+	timerfd_settime(fd, 0, &spec, nullptr);
+
+	// Expirations read together are ticks elapsed while the previous groups were running
+	const uint32_t total = (uint64_t)duration * 1000 / m_base;
+	uint32_t elapsed = 0;
+	while (elapsed < total) {
+		uint64_t expirations = 0;
+		if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+			break;
+		}
+		elapsed += expirations;
+		advance(expirations);
+	}
+
+	close(fd);
+	return elapsed;
+}
+#endif
@@ -0,0 +1,88 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_EXECUTIVE_H
+#define AGILE_EXECUTIVE_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+// Max number of rate groups of an Executive
+#ifndef AGILE_EXEC_GROUPS
+#define AGILE_EXEC_GROUPS 4
+#endif
+
+// Machines executed with the same period, with timing statistics (microseconds)
+struct RateGroup
+{
+	StateMachine *const *machines;
+	uint8_t count;
+	uint32_t period;
+	uint32_t divider;       // Period in base ticks
+	uint32_t countdown;     // Base ticks to the next release
+	uint32_t release;       // Nominal time of the next release
+
+	uint32_t runs;
+	uint32_t overruns;      // Releases lost because the previous run (or other groups) took too long
+	uint32_t maxJitter;     // Max delay of a run from its nominal release time
+	uint32_t maxDuration;   // Longest run of the group
+};
+
+/*
+* Fixed rate executive: machines are grouped by period (i.e. 1 ms, 10 ms, 100 ms) and each group is executed
+* at its release times, faster groups first. Time is counted in base ticks (greatest common divisor of the periods).
+* Drive it with poll() from loop(), or with tick() from a periodic timer (a timer task on ESP32, or an interrupt if
+* the callbacks of the machines are safe there). On Linux runFor() uses a timerfd as periodic timer.
+*/
+class Executive
+{
+public:
+	// Add a group of machines executed every period (microseconds): false if there are already AGILE_EXEC_GROUPS groups
+	bool addGroup(uint32_t period, StateMachine *const *machines, uint8_t count);
+
+	template <uint8_t N>
+	bool addGroup(uint32_t period, StateMachine *const (&machines)[N]) { return addGroup(period, machines, N); }
+
+	// Time 0 of the release times (done by the first poll() or tick() if not called)
+	void start();
+
+	// Cooperative mode: call as often as possible, runs the groups released since last call (returns groups executed)
+	uint8_t poll();
+
+	// Timer mode: call every base period, runs the groups released at this tick (returns groups executed)
+	uint8_t tick();
+
+#ifdef __linux__
+	// Run for duration (milliseconds) driven by a Linux timerfd with the base period (returns the ticks elapsed)
+	uint32_t runFor(uint32_t duration);
+#endif
+
+	// Base tick (microseconds) and ticks elapsed since start()
+	uint32_t getBasePeriod() const { return m_base; }
+	uint32_t getTicks() const { return m_ticks; }
+
+	uint8_t getGroupsNumber() const { return m_groupsCount; }
+	const RateGroup *getGroup(uint8_t index) const { return index < m_groupsCount ? &m_groups[index] : nullptr; }
+
+	void resetStats();
+
+	// Time source of the executive (micros(), CLOCK_MONOTONIC on Linux)
+	static uint32_t now();
+
+private:
+	void begin(uint32_t time);
+	uint8_t advance(uint32_t ticks);
+
+	RateGroup m_groups[AGILE_EXEC_GROUPS];
+	uint8_t m_groupsCount = 0;
+	uint32_t m_base = 0;
+
+	bool m_started = false;
+	volatile bool m_busy = false;
+	volatile uint32_t m_pending = 0;
+	uint32_t m_start = 0;
+	uint32_t m_nextTick = 0;
+	uint32_t m_ticks = 0;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "FlashStateMachine.h"
+
+void FlashStateMachine::readState(uint8_t index, FlashState &state) const {
+	memcpy_P(&state, &m_states[index], sizeof(FlashState));
+}
+
+
+void FlashStateMachine::setInitialState(uint8_t index) {
+	if (index < m_numStates) {
+		m_current = index;
+	}
+}
+
+
+void FlashStateMachine::start() {
+	if (m_numStates == 0) {
+		return;
+	}
+	enterState(m_current, AgileClock::now());
+	m_flags |= STARTED;
+}
+
+
+void FlashStateMachine::stop() {
+	m_flags &= ~STARTED;
+}
+
+
+const __FlashStringHelper *FlashStateMachine::getActiveStateName_P() const {
+	return reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&m_states[m_current].name));
+}
+
+
+void FlashStateMachine::enterState(uint8_t index, uint32_t now) {
+	m_current = index;
+	m_enterTime = now;
+	m_flags = (m_flags & STARTED) | FIRST_RUN;
+
+	// Transitions and actions are sorted by state: find the first one of the new state
+	m_firstTransition = 0;
+	while (m_firstTransition < m_numTransitions && pgm_read_byte(&m_transitions[m_firstTransition].from) < index) {
+		m_firstTransition++;
+	}
+
+	m_firstAction = 0;
+	while (m_firstAction < m_numActions && pgm_read_byte(&m_actions[m_firstAction].state) < index) {
+		m_firstAction++;
+	}
+}
+
+
+void FlashStateMachine::leaveState() {
+	// Clear the actions before exit actual state
+	FlashAction action;
+	for (uint8_t i = m_firstAction; i < m_numActions; i++) {
+		memcpy_P(&action, &m_actions[i], sizeof(FlashAction));
+		if (action.state != m_current) {
+			break;
+		}
+
+		switch (action.type) {
+			case Action::Type::N:
+			case Action::Type::L:
+			case Action::Type::D:
+			case Action::Type::RE:
+			case Action::Type::P:
+				*action.target = false;
+				break;
+			case Action::Type::FE:
+				*action.target = true;
+				break;
+		}
+	}
+}
+
+
+int FlashStateMachine::runTransitions(uint32_t elapsed) {
+	FlashTransition tr;
+	for (uint8_t i = m_firstTransition; i < m_numTransitions; i++) {
+		memcpy_P(&tr, &m_transitions[i], sizeof(FlashTransition));
+		if (tr.from != m_current) {
+			break;
+		}
+
+		if (tr.trigger_cb != nullptr) {
+			if (tr.trigger_cb()) return tr.to;
+		}
+		else if (tr.trigger_var != nullptr) {
+			if (*tr.trigger_var) return tr.to;
+		}
+		else if (tr.timeout > 0 && elapsed >= tr.timeout) {
+			return tr.to;
+		}
+	}
+	return -1;
+}
+
+
+void FlashStateMachine::runActions(uint32_t now) {
+	// The first run of the state is the timer shared by all L, D and P actions: they change the target as Action does
+	if (m_flags & FIRST_RUN) {
+		m_actionsStart = now;
+		m_actionsRun = now;
+	}
+	const uint32_t elapsed = now - m_actionsStart;
+	const uint32_t previous = m_actionsRun - m_actionsStart;
+	m_actionsRun = now;
+
+	FlashAction action;
+	for (uint8_t i = m_firstAction; i < m_numActions; i++) {
+		memcpy_P(&action, &m_actions[i], sizeof(FlashAction));
+		if (action.state != m_current) {
+			break;
+		}
+
+		switch (action.type) {
+			case Action::Type::N:
+			case Action::Type::S:
+				*action.target = true;
+				break;
+			case Action::Type::R:
+				*action.target = false;
+				break;
+			case Action::Type::L:
+				if (m_flags & FIRST_RUN) {
+					*action.target = true;
+				}
+				else if (elapsed > action.time) {
+					*action.target = false;
+				}
+				break;
+			case Action::Type::D:
+				// Set once when the time elapses (not re-asserted while the state is active)
+				if (m_flags & FIRST_RUN) {
+					*action.target = false;
+				}
+				else if (previous <= action.time && elapsed > action.time) {
+					*action.target = true;
+				}
+				break;
+			case Action::Type::RE:
+				*action.target = (m_flags & FIRST_RUN);
+				break;
+			case Action::Type::P: {
+				// On time at the start of each period (default half period)
+				const uint32_t onTime = action.onTime ? action.onTime : action.time / 2;
+				*action.target = action.time == 0 || elapsed % action.time < onTime;
+				break;
+			}
+		}
+	}
+}
+
+
+bool FlashStateMachine::execute() {
+	if (!(m_flags & STARTED)) {
+		return false;
+	}
+
+	const uint32_t now = AgileClock::now();
+	const uint32_t elapsed = now - m_enterTime;
+	FlashState state;
+	readState(m_current, state);
+
+	// Max time elapsed: flag the timeout once per activation, then apply the policy of the state
+	int next = -1;
+	if (state.maxTime > 0 && elapsed >= state.maxTime) {
+		if (!(m_flags & TIMEOUT)) {
+			m_flags |= TIMEOUT;
+			if (state.maxTimePolicy == FlashState::MAX_TIME_HANDLER && m_onStall != nullptr) {
+				m_onStall(m_current, elapsed);
+			}
+		}
+		if (state.maxTimePolicy == FlashState::MAX_TIME_TRANSITION && state.timeoutState < m_numStates) {
+			next = state.timeoutState;
+		}
+	}
+
+	// Min time not elapsed: transitions are not evaluated, but state is still active
+	if (next < 0 && elapsed >= state.minTime) {
+		next = runTransitions(elapsed);
+	}
+
+	if (next >= 0) {
+		leaveState();
+		if (state.onLeaving != nullptr) {
+			state.onLeaving();
+		}
+
+		enterState(next, now);
+		readState(m_current, state);
+		if (state.onEntering != nullptr) {
+			state.onEntering();
+		}
+		return true;
+	}
+
+	if (state.onRunning != nullptr) {
+		state.onRunning();
+	}
+
+	runActions(now);
+	m_flags &= ~FIRST_RUN;
+	return false;
+}
+
+
+void FlashStateMachine::setCurrentState(uint8_t index, bool callOnEntering, bool callOnLeaving) {
+	if (index >= m_numStates) {
+		return;
+	}
+
+	FlashState state;
+	readState(m_current, state);
+	leaveState();
+	if (state.onLeaving != nullptr && callOnLeaving) {
+		state.onLeaving();
+	}
+
+	enterState(index, AgileClock::now());
+	readState(m_current, state);
+	if (state.onEntering != nullptr && callOnEntering) {
+		state.onEntering();
+	}
+}
@@ -0,0 +1,158 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_FLASH_STATE_MACHINE_H
+#define AGILE_FLASH_STATE_MACHINE_H
+#include "Arduino.h"
+#include "Action.h"
+#include "Clock.h"
+#include "Transition.h"
+
+using state_cb = void (*)();
+
+// Called once when a state with policy MAX_TIME_HANDLER stays active beyond its max time (index of the state)
+using flash_stall_cb = void (*)(uint8_t state, uint32_t elapsed);
+
+/*
+* Table driven State Machine: the whole definition of the machine (states, transitions, actions, names)
+* is stored in constant tables that can be placed in flash memory with PROGMEM.
+* Only the runtime (active state, enter time and a few flags) is kept in SRAM.
+*
+* Transitions and actions must be sorted by the index of the state they belong to.
+*/
+
+// A state of the machine. Name must be a PROGMEM string (or nullptr)
+// Max time policy and timeout state can be omitted: the timeout is only flagged, as State::setStateMaxTime()
+struct FlashState
+{
+	// Same policies of State::MaxTimePolicy
+	enum MaxTimePolicy : uint8_t
+	{
+		MAX_TIME_COUNT,
+		MAX_TIME_HANDLER,
+		MAX_TIME_TRANSITION
+	};
+
+	const char *name;
+	uint32_t minTime;
+	uint32_t maxTime;
+	state_cb onEntering;
+	state_cb onLeaving;
+	state_cb onRunning;
+	uint8_t maxTimePolicy;
+	uint8_t timeoutState;
+};
+
+// Transition from state "from" to state "to", triggered by (first not null) callback, bool variable or timeout
+struct FlashTransition
+{
+	uint8_t from;
+	uint8_t to;
+	bool *trigger_var;
+	condition_cb trigger_cb;
+	uint32_t timeout;
+};
+
+// Action of state "state" on target variable (Action::Type N, S, R, L, D, RE, FE and P)
+// On time of P actions can be omitted (half period, as Action::setOnTime())
+struct FlashAction
+{
+	uint8_t state;
+	uint8_t type;
+	bool *target;
+	uint32_t time;
+	uint32_t onTime;
+};
+
+class FlashStateMachine
+{
+public:
+	FlashStateMachine(const FlashState *states, uint8_t numStates,
+					  const FlashTransition *transitions, uint8_t numTransitions,
+					  const FlashAction *actions = nullptr, uint8_t numActions = 0)
+		: m_states(states), m_transitions(transitions), m_actions(actions),
+		  m_numStates(numStates), m_numTransitions(numTransitions), m_numActions(numActions)
+	{
+	}
+
+	template <uint8_t S, uint8_t T>
+	FlashStateMachine(const FlashState (&states)[S], const FlashTransition (&transitions)[T])
+		: FlashStateMachine(states, S, transitions, T) {}
+
+	template <uint8_t S, uint8_t T, uint8_t A>
+	FlashStateMachine(const FlashState (&states)[S], const FlashTransition (&transitions)[T], const FlashAction (&actions)[A])
+		: FlashStateMachine(states, S, transitions, T, actions, A) {}
+
+	// Sets the initial state (index in states table)
+	void setInitialState(uint8_t index);
+
+	// Force to the specific state the State Machine
+	void setCurrentState(uint8_t index, bool callOnEntering = true, bool callOnLeaving = true);
+
+	// Start the State Machine
+	void start();
+
+	// Stop the State Machine
+	void stop();
+
+	// Run the state machine
+	bool execute();
+
+	// Returns the numbers of states of State Machine
+	uint8_t GetStatesNumber() const { return m_numStates; }
+
+	// Index of the currently active state
+	uint8_t getCurrentState() const { return m_current; }
+
+	// Returns the name of the currently active state as pointer to flash string helper
+	const __FlashStringHelper *getActiveStateName_P() const;
+
+	// Return the last enter time
+	uint32_t getLastEnterTime() const { return m_enterTime; }
+
+	// True if current state is running for a time greater then max time
+	bool getTimeout() const { return m_flags & TIMEOUT; }
+
+	// Reset the enter time of current state
+	void resetEnterTime() { m_enterTime = AgileClock::now(); }
+
+	// Called once when a state with policy MAX_TIME_HANDLER stays active beyond its max time (it must not change the state)
+	void setStallHandler(flash_stall_cb handler) { m_onStall = handler; }
+
+private:
+	enum Flags : uint8_t
+	{
+		STARTED = 0x01,
+		TIMEOUT = 0x02,
+		FIRST_RUN = 0x04
+	};
+
+	void enterState(uint8_t index, uint32_t now);
+	void leaveState();
+	int runTransitions(uint32_t elapsed);
+	void runActions(uint32_t now);
+	void readState(uint8_t index, FlashState &state) const;
+
+	// Constant definition (tables in flash)
+	const FlashState *m_states;
+	const FlashTransition *m_transitions;
+	const FlashAction *m_actions;
+	uint8_t m_numStates;
+	uint8_t m_numTransitions;
+	uint8_t m_numActions;
+
+	// Runtime
+	uint8_t m_current = 0;
+	uint8_t m_firstTransition = 0;
+	uint8_t m_firstAction = 0;
+	uint8_t m_flags = 0;
+	uint32_t m_enterTime = 0;
+
+	// Timer of L, D and P actions (first run of the state, as StateMachine) and time of their previous run
+	uint32_t m_actionsStart = 0;
+	uint32_t m_actionsRun = 0;
+	flash_stall_cb m_onStall = nullptr;
+};
+
+#endif
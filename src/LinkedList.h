@@ -32,6 +32,11 @@ public:
     T last();
     T next();
     T prev();
+    T get(int index);
+
+    // Node of the iterator, to resume the iteration later from the same element (valid until the node is deleted)
+    ListNode<T>* position();
+    T resume(ListNode<T>* node);
 
     int size();
     void append(T);
@@ -113,13 +118,38 @@ T LinkedList<T>::prev()
     if (length == 0)
         return nullptr;
 
-    if (curr->prev != nullptr)
+    if (curr->prev == nullptr)
         return nullptr;
 
     curr = curr->prev;
     return curr->element;
 }
 
+template <class T>
+T LinkedList<T>::get(int index)
+{
+    if (index < 0 || index >= length)
+        return nullptr;
+
+    curr = head;
+    for (int i = 0; i < index; i++)
+        curr = curr->next;
+    return curr->element;
+}
+
+template <class T>
+ListNode<T>* LinkedList<T>::position()
+{
+    return curr;
+}
+
+template <class T>
+T LinkedList<T>::resume(ListNode<T>* node)
+{
+    curr = node;
+    return curr->element;
+}
+
 template <class T>
 void LinkedList<T>::deleteCurrent()
 {
@@ -0,0 +1,287 @@
+#include "MachineGraph.h"
+#include "StateGroup.h"
+
+// Escape double quotes of names inside graph labels
+class QuotedPrint : public Print
+{
+public:
+	QuotedPrint(Print &out) : m_out(out) {}
+
+	size_t write(uint8_t c) override {
+		if (c == '"' || c == '\\') {
+			m_out.write('\\');
+		}
+		return m_out.write(c);
+	}
+
+private:
+	Print &m_out;
+};
+
+
+void MachineGraph::printLabel(Print &out, Transition *tr) {
+	switch (tr->getTriggerType()) {
+		case Transition::ON_VARIABLE:
+			out.print(F("var"));
+			break;
+		case Transition::ON_CALLBACK:
+			out.print(F("callback"));
+			break;
+		case Transition::ON_GUARD:
+			out.print(F("guard"));
+			break;
+		case Transition::ON_EVENT:
+			out.print(F("event "));
+			out.print(tr->getTriggerEvent());
+			break;
+		default:
+			out.print(F("after "));
+			out.print(tr->getTimeout());
+			out.print(F(" ms"));
+	}
+	if (tr->getOutputState()->isHistory()) {
+		out.print(F(" (history)"));
+	}
+}
+
+
+// History of a group is drawn (and analyzed) as the initial state of the group
+State *MachineGraph::target(State *state) {
+	if (state != nullptr && state->isHistory()) {
+		return state->getGroup()->getInitialState();
+	}
+	return state;
+}
+
+
+void MachineGraph::printDot(Print &out) {
+	QuotedPrint quoted(out);
+	out.println(F("digraph StateMachine {"));
+	out.println(F("  rankdir=LR;"));
+	out.println(F("  node [shape=box, style=rounded];"));
+
+	for (uint8_t i = 0; i < m_fsm.GetStatesNumber(); i++) {
+		State *state = m_fsm.getState(i);
+		out.print(F("  s"));
+		out.print(i);
+		out.print(F(" [label=\""));
+		state->printName(quoted);
+		out.print(state == m_fsm.getCurrentState() ? F("\", penwidth=2];") : F("\"];"));
+		out.println();
+	}
+
+	for (uint8_t i = 0; i < m_fsm.GetStatesNumber(); i++) {
+		State *state = m_fsm.getState(i);
+		for (uint8_t t = 0; t < state->getTransitionsNumber(); t++) {
+			Transition *tr = state->getTransition(t);
+			out.print(F("  s"));
+			out.print(i);
+			out.print(F(" -> s"));
+			out.print(target(tr->getOutputState())->getIndex());
+			out.print(F(" [label=\""));
+			printLabel(out, tr);
+			out.println(F("\"];"));
+		}
+
+		if (state->getTimeoutState() != nullptr) {
+			out.print(F("  s"));
+			out.print(i);
+			out.print(F(" -> s"));
+			out.print(target(state->getTimeoutState())->getIndex());
+			out.print(F(" [label=\"max time "));
+			out.print(state->getStateMaxTime());
+			out.println(F(" ms\", style=dashed];"));
+		}
+	}
+	out.println(F("}"));
+}
+
+
+void MachineGraph::printMermaid(Print &out) {
+	out.println(F("stateDiagram-v2"));
+
+	for (uint8_t i = 0; i < m_fsm.GetStatesNumber(); i++) {
+		State *state = m_fsm.getState(i);
+		out.print(F("  s"));
+		out.print(i);
+		out.print(F(" : "));
+		state->printName(out);
+		out.println();
+	}
+
+	if (m_fsm.getCurrentState() != nullptr) {
+		out.print(F("  [*] --> s"));
+		out.println(m_fsm.getCurrentState()->getIndex());
+	}
+
+	for (uint8_t i = 0; i < m_fsm.GetStatesNumber(); i++) {
+		State *state = m_fsm.getState(i);
+		for (uint8_t t = 0; t < state->getTransitionsNumber(); t++) {
+			Transition *tr = state->getTransition(t);
+			out.print(F("  s"));
+			out.print(i);
+			out.print(F(" --> s"));
+			out.print(target(tr->getOutputState())->getIndex());
+			out.print(F(" : "));
+			printLabel(out, tr);
+			out.println();
+		}
+
+		if (state->getTimeoutState() != nullptr) {
+			out.print(F("  s"));
+			out.print(i);
+			out.print(F(" --> s"));
+			out.print(target(state->getTimeoutState())->getIndex());
+			out.print(F(" : max time "));
+			out.print(state->getStateMaxTime());
+			out.println(F(" ms"));
+		}
+	}
+}
+
+
+// Order of evaluation: higher priority first, then in the order transitions were added
+bool MachineGraph::evaluatedBefore(Transition *a, uint8_t indexA, Transition *b, uint8_t indexB) {
+	if (a->getPriority() != b->getPriority()) {
+		return a->getPriority() > b->getPriority();
+	}
+	return indexA < indexB;
+}
+
+
+// Transition that can fire in the same tick the state is entered (events are handled one per tick)
+bool MachineGraph::isImmediate(State *state, Transition *tr) {
+	return state->getStateMinTime() == 0 && tr->getTriggerType() != Transition::ON_TIMEOUT && tr->getTriggerType() != Transition::ON_EVENT;
+}
+
+
+// Depth first search on immediate transitions (mark: 0 not visited, 1 in current path, 2 done)
+uint8_t MachineGraph::findCycles(uint8_t index, uint8_t *mark, Print &report) {
+	uint8_t found = 0;
+	State *state = m_fsm.getState(index);
+	mark[index] = 1;
+
+	for (uint8_t t = 0; t < state->getTransitionsNumber(); t++) {
+		Transition *tr = state->getTransition(t);
+		if (!isImmediate(state, tr)) {
+			continue;
+		}
+
+		uint8_t next = target(tr->getOutputState())->getIndex();
+		if (mark[next] == 1) {
+			report.print(F("Zero time cycle: "));
+			state->printName(report);
+			report.print(F(" -> "));
+			target(tr->getOutputState())->printName(report);
+			report.println();
+			found++;
+		}
+		else if (mark[next] == 0) {
+			found += findCycles(next, mark, report);
+		}
+	}
+
+	mark[index] = 2;
+	return found;
+}
+
+
+uint8_t MachineGraph::analyze(Print &report) {
+	const uint8_t count = m_fsm.GetStatesNumber();
+	uint8_t issues = 0;
+	if (count == 0 || m_fsm.getCurrentState() == nullptr) {
+		return 0;
+	}
+
+	uint8_t *mark = new uint8_t[count];
+	memset(mark, 0, count);
+
+	// Reachable states from initial state (breadth first visit)
+	uint8_t *queue = new uint8_t[count];
+	uint8_t head = 0, tail = 0;
+	queue[tail++] = m_fsm.getCurrentState()->getIndex();
+	mark[queue[0]] = 1;
+	while (head < tail) {
+		State *state = m_fsm.getState(queue[head++]);
+		for (uint8_t t = 0; t <= state->getTransitionsNumber(); t++) {
+			State *next = target((t < state->getTransitionsNumber()) ? state->getTransition(t)->getOutputState() : state->getTimeoutState());
+			if (next != nullptr && !mark[next->getIndex()]) {
+				mark[next->getIndex()] = 1;
+				queue[tail++] = next->getIndex();
+			}
+		}
+	}
+
+	for (uint8_t i = 0; i < count; i++) {
+		State *state = m_fsm.getState(i);
+		if (!mark[i]) {
+			report.print(F("Unreachable state: "));
+			state->printName(report);
+			report.println();
+			issues |= UNREACHABLE_STATE;
+		}
+
+		if (count > 1 && state->getTransitionsNumber() == 0 && state->getTimeoutState() == nullptr) {
+			report.print(F("State without exits: "));
+			state->printName(report);
+			report.println();
+			issues |= NO_EXIT;
+		}
+
+		// A transition is shadowed by one evaluated before with the same trigger (or a shorter timeout)
+		for (uint8_t t = 0; t < state->getTransitionsNumber(); t++) {
+			Transition *tr = state->getTransition(t);
+			bool shadowed = tr->getTriggerType() == Transition::ON_TIMEOUT && tr->getTimeout() == 0;
+			if (tr->getTriggerType() == Transition::ON_TIMEOUT && state->getTimeoutState() != nullptr
+				&& tr->getTimeout() >= state->getStateMaxTime()) {
+				shadowed = true;
+			}
+
+			for (uint8_t p = 0; p < state->getTransitionsNumber() && !shadowed; p++) {
+				Transition *prev = state->getTransition(p);
+				if (!evaluatedBefore(prev, p, tr, t) || prev->getTriggerType() != tr->getTriggerType()) {
+					continue;
+				}
+				switch (tr->getTriggerType()) {
+					case Transition::ON_VARIABLE:
+						shadowed = prev->getTriggerVariable() == tr->getTriggerVariable();
+						break;
+					case Transition::ON_CALLBACK:
+						shadowed = prev->getTriggerCallback() == tr->getTriggerCallback();
+						break;
+					case Transition::ON_GUARD:
+						shadowed = prev->getTriggerGuard() == tr->getTriggerGuard();
+						break;
+					case Transition::ON_EVENT:
+						shadowed = prev->getTriggerEvent() == tr->getTriggerEvent();
+						break;
+					default:
+						shadowed = prev->getTimeout() <= tr->getTimeout();
+				}
+			}
+
+			if (shadowed) {
+				report.print(F("Shadowed transition: "));
+				state->printName(report);
+				report.print(F(" -> "));
+				target(tr->getOutputState())->printName(report);
+				report.print(F(" ("));
+				printLabel(report, tr);
+				report.println(F(")"));
+				issues |= SHADOWED_TRANSITION;
+			}
+		}
+	}
+
+	// Cycles of transitions that can fire without any time elapsing
+	memset(mark, 0, count);
+	for (uint8_t i = 0; i < count; i++) {
+		if (mark[i] == 0 && findCycles(i, mark, report)) {
+			issues |= ZERO_TIME_CYCLE;
+		}
+	}
+
+	delete[] queue;
+	delete[] mark;
+	return issues;
+}
@@ -0,0 +1,48 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_MACHINE_GRAPH_H
+#define AGILE_MACHINE_GRAPH_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+/*
+* Inspection of a built machine: export as graph (Graphviz DOT or Mermaid state diagram)
+* and static analysis of common design errors.
+* Call after the machine is defined and the initial state is set, before start().
+*/
+class MachineGraph
+{
+public:
+	// Issues found by analyze()
+	enum Issue : uint8_t
+	{
+		UNREACHABLE_STATE = 0x01,	// State can't be reached from initial state
+		NO_EXIT = 0x02,				// State without transitions (the machine remains stuck there), if the machine has more states
+		SHADOWED_TRANSITION = 0x04,	// Transition that can never fire (duplicated trigger or longer timeout)
+		ZERO_TIME_CYCLE = 0x08		// Cycle of states without any time constraint (possible livelock)
+	};
+
+	MachineGraph(StateMachine &fsm) : m_fsm(fsm) {}
+
+	// Graphviz DOT format (i.e. dot -Tpng machine.dot -o machine.png)
+	void printDot(Print &out);
+
+	// Mermaid state diagram
+	void printMermaid(Print &out);
+
+	// Check the machine and print a line for each issue found. Returns the Issue flags found (0 = no issues)
+	uint8_t analyze(Print &report);
+
+private:
+	void printLabel(Print &out, Transition *tr);
+	State *target(State *state);
+	bool isImmediate(State *state, Transition *tr);
+	bool evaluatedBefore(Transition *a, uint8_t indexA, Transition *b, uint8_t indexB);
+	uint8_t findCycles(uint8_t index, uint8_t *mark, Print &report);
+
+	StateMachine &m_fsm;
+};
+
+#endif
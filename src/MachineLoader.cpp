@@ -0,0 +1,222 @@
+#include "MachineLoader.h"
+
+/*
+* Binary format (times are unsigned LEB128, names are null terminated, "" means none):
+* 'A' 'S' 'M' version
+* number of states, initial state
+*   name, min time, max time, onEnter, onExit, onRun        (for each state)
+* number of transitions
+*   from, to, kind (Transition::Trigger), name or timeout
+* number of actions
+*   state, type, target name, time
+*/
+
+bool MachineLoader::readByte(uint8_t &value) {
+	if (m_pos >= m_size) {
+		return false;
+	}
+	value = m_buffer[m_pos++];
+	return true;
+}
+
+
+// The 5th byte has only 4 bits of a 32 bit value (and no continuation): other bits set are an overflow
+bool MachineLoader::readTime(uint32_t &value) {
+	value = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7) {
+		uint8_t b;
+		if (!readByte(b)) {
+			return false;
+		}
+		if (shift == 28 && (b & 0xF0)) {
+			m_overflow = true;
+			return false;
+		}
+		value |= (uint32_t)(b & 0x7F) << shift;
+		if (!(b & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool MachineLoader::readName(const char *&name) {
+	name = reinterpret_cast<const char *>(m_buffer + m_pos);
+	while (m_pos < m_size) {
+		if (m_buffer[m_pos++] == '\0') {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+const MachineBinding *MachineLoader::findBinding(const char *name, uint8_t kind) {
+	for (uint8_t i = 0; i < m_count; i++) {
+		if (m_bindings[i].kind == kind && strcmp(m_bindings[i].name, name) == 0) {
+			return &m_bindings[i];
+		}
+	}
+	m_unknown = true;
+	return nullptr;
+}
+
+
+bool MachineLoader::readCallback(state_cb &cb) {
+	const char *name;
+	if (!readName(name)) {
+		return false;
+	}
+
+	cb = nullptr;
+	if (name[0] != '\0') {
+		const MachineBinding *binding = findBinding(name, MachineBinding::CALLBACK);
+		if (binding != nullptr) {
+			cb = binding->callback;
+		}
+	}
+	return true;
+}
+
+
+// Validate the whole description first, so a machine is changed only by a valid one
+MachineLoader::Error MachineLoader::load(StateMachine &fsm, const uint8_t *buffer, size_t size) {
+	const Error error = parse(nullptr, buffer, size);
+	if (error != LOAD_OK) {
+		return error;
+	}
+	return parse(&fsm, buffer, size);
+}
+
+
+// Read the description and, if fsm is not nullptr, add states, transitions and actions to it
+MachineLoader::Error MachineLoader::parse(StateMachine *fsm, const uint8_t *buffer, size_t size) {
+	m_buffer = buffer;
+	m_size = size;
+	m_pos = 0;
+	m_unknown = false;
+	m_overflow = false;
+
+	uint8_t version, count, initial;
+	if (size < 4 || buffer[0] != 'A' || buffer[1] != 'S' || buffer[2] != 'M') {
+		return LOAD_BAD_HEADER;
+	}
+	m_pos = 3;
+	readByte(version);
+	if (version != AGILE_MACHINE_FORMAT_VERSION) {
+		return LOAD_BAD_HEADER;
+	}
+
+	// States
+	const uint8_t first = (fsm != nullptr) ? fsm->GetStatesNumber() : 0;
+	if (!readByte(count) || !readByte(initial)) {
+		return LOAD_TRUNCATED;
+	}
+	const uint8_t states = count;
+	if (initial >= states) {
+		return LOAD_BAD_STATE;
+	}
+
+	for (uint8_t i = 0; i < states; i++) {
+		const char *name;
+		uint32_t min, max;
+		state_cb enter, exit, run;
+		if (!readName(name) || !readTime(min) || !readTime(max)
+			|| !readCallback(enter) || !readCallback(exit) || !readCallback(run)) {
+			return m_overflow ? LOAD_BAD_VALUE : LOAD_TRUNCATED;
+		}
+		if (m_unknown) {
+			return LOAD_UNKNOWN_NAME;
+		}
+		if (fsm != nullptr) {
+			fsm->addState(name, min, max, enter, exit, run);
+		}
+	}
+
+	// Transitions
+	if (!readByte(count)) {
+		return LOAD_TRUNCATED;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		uint8_t from, to, kind;
+		if (!readByte(from) || !readByte(to) || !readByte(kind)) {
+			return LOAD_TRUNCATED;
+		}
+
+		if (kind > Transition::ON_TIMEOUT) {
+			return LOAD_BAD_VALUE;
+		}
+		if (from >= states || to >= states) {
+			return LOAD_BAD_STATE;
+		}
+		State *in = (fsm != nullptr) ? fsm->getState(first + from) : nullptr;
+		State *out = (fsm != nullptr) ? fsm->getState(first + to) : nullptr;
+
+		if (kind == Transition::ON_TIMEOUT) {
+			uint32_t timeout;
+			if (!readTime(timeout)) {
+				return m_overflow ? LOAD_BAD_VALUE : LOAD_TRUNCATED;
+			}
+			if (in != nullptr) {
+				in->addTransition(out, timeout);
+			}
+			continue;
+		}
+
+		const char *name;
+		if (!readName(name)) {
+			return LOAD_TRUNCATED;
+		}
+		const MachineBinding *binding = findBinding(name, kind == Transition::ON_VARIABLE ? MachineBinding::VARIABLE : MachineBinding::CONDITION);
+		if (binding == nullptr) {
+			return LOAD_UNKNOWN_NAME;
+		}
+		if (in == nullptr) {
+			continue;
+		}
+		if (kind == Transition::ON_VARIABLE) {
+			in->addTransition(out, *binding->variable);
+		}
+		else {
+			in->addTransition(out, binding->condition);
+		}
+	}
+
+	// Actions
+	if (!readByte(count)) {
+		return LOAD_TRUNCATED;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		uint8_t index, type;
+		const char *name;
+		uint32_t time;
+		if (!readByte(index) || !readByte(type) || !readName(name) || !readTime(time)) {
+			return m_overflow ? LOAD_BAD_VALUE : LOAD_TRUNCATED;
+		}
+
+		if (index >= states) {
+			return LOAD_BAD_STATE;
+		}
+		if (type > Action::Type::P) {
+			return LOAD_BAD_VALUE;
+		}
+		const MachineBinding *binding = findBinding(name, MachineBinding::VARIABLE);
+		if (binding == nullptr) {
+			return LOAD_UNKNOWN_NAME;
+		}
+		if (fsm != nullptr) {
+			fsm->getState(first + index)->addAction(type, *binding->variable, time);
+		}
+	}
+
+	// The description must end with the last action
+	if (m_pos != m_size) {
+		return LOAD_TRAILING_DATA;
+	}
+
+	if (fsm != nullptr) {
+		fsm->setInitialState(fsm->getState(first + initial));
+	}
+	return LOAD_OK;
+}
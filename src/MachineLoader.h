@@ -0,0 +1,86 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_MACHINE_LOADER_H
+#define AGILE_MACHINE_LOADER_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+// Version of the binary machine description (see extras/machine_compiler.py)
+#define AGILE_MACHINE_FORMAT_VERSION 1
+
+// A name used in the machine description, bound to a bool variable or to a callback function
+struct MachineBinding
+{
+	enum Kind : uint8_t
+	{
+		VARIABLE,
+		CONDITION,
+		CALLBACK
+	};
+
+	MachineBinding(const char *n, bool &var) : name(n), kind(VARIABLE), variable(&var) {}
+	MachineBinding(const char *n, condition_cb cb) : name(n), kind(CONDITION), condition(cb) {}
+	MachineBinding(const char *n, state_cb cb) : name(n), kind(CALLBACK), callback(cb) {}
+
+	const char *name;
+	uint8_t kind;
+	union
+	{
+		bool *variable;
+		condition_cb condition;
+		state_cb callback;
+	};
+};
+
+/*
+* Build a StateMachine from a compact binary description: a first pass checks the whole description, a second one builds the machine.
+* State names point inside the description buffer, so it must remain valid while the machine is in use.
+* Only the states, transitions and actions of the machine are allocated.
+*/
+class MachineLoader
+{
+public:
+	enum Error : uint8_t
+	{
+		LOAD_OK,
+		LOAD_BAD_HEADER,	// Not a machine description or wrong version
+		LOAD_TRUNCATED,		// Description ends before expected
+		LOAD_BAD_STATE,		// Reference to a state index not defined
+		LOAD_UNKNOWN_NAME,	// Name not found in bindings (or bound to a wrong kind)
+		LOAD_BAD_VALUE,		// Time that doesn't fit in 32 bits, unknown transition kind or action type
+		LOAD_TRAILING_DATA	// Bytes after the last action (truncated or wrongly concatenated description)
+	};
+
+	MachineLoader(const MachineBinding *bindings, uint8_t count) : m_bindings(bindings), m_count(count) {}
+
+	template <uint8_t N>
+	MachineLoader(const MachineBinding (&bindings)[N]) : MachineLoader(bindings, N) {}
+
+	// Add states, transitions and actions described in buffer to the machine and set the initial state
+	// (the whole description is checked before, so the machine is not changed if an error is returned)
+	Error load(StateMachine &fsm, const uint8_t *buffer, size_t size);
+
+	// Offset in buffer where the last load() has stopped (usefull to locate an error)
+	size_t getPosition() const { return m_pos; }
+
+private:
+	Error parse(StateMachine *fsm, const uint8_t *buffer, size_t size);
+	bool readByte(uint8_t &value);
+	bool readTime(uint32_t &value);
+	bool readName(const char *&name);
+	const MachineBinding *findBinding(const char *name, uint8_t kind);
+	bool readCallback(state_cb &cb);
+
+	const MachineBinding *m_bindings;
+	uint8_t m_count;
+
+	const uint8_t *m_buffer = nullptr;
+	size_t m_size = 0;
+	size_t m_pos = 0;
+	bool m_unknown = false;
+	bool m_overflow = false;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "MachineRunner.h"
+
+MachineRunner::MachineRunner(StateMachine *const *machines, uint8_t count, uint32_t budget)
+	: m_machines(machines), m_count(count), m_budget(budget) {
+	m_maxDuration = new uint32_t[count];
+	resetStats();
+}
+
+
+void MachineRunner::resetStats() {
+	memset(m_maxDuration, 0, m_count * sizeof(uint32_t));
+	m_maxRun = 0;
+	m_overruns = 0;
+}
+
+
+uint8_t MachineRunner::run() {
+	if (m_count == 0) {
+		return 0;
+	}
+
+	CachedCondition::nextTick();
+	const uint32_t start = micros();
+	uint32_t elapsed = 0;
+	uint8_t done = 0;
+	const uint8_t limit = (m_maxMachines == 0 || m_maxMachines > m_count) ? m_count : m_maxMachines;
+
+	// At least one machine for each call, then while the longest execute() of next machine fits in the budget
+	do {
+		if (done > 0 && elapsed + m_maxDuration[m_next] > m_budget) {
+			break;
+		}
+
+		const uint8_t index = m_next;
+		m_next = (m_next + 1 < m_count) ? m_next + 1 : 0;
+
+		const uint32_t t0 = micros();
+		m_machines[index]->execute();
+		const uint32_t duration = micros() - t0;
+		if (duration > m_maxDuration[index]) {
+			m_maxDuration[index] = duration;
+		}
+
+		done++;
+		elapsed = micros() - start;
+		if (elapsed > m_budget) {
+			m_overruns++;
+			if (m_onOverrun != nullptr) {
+				m_onOverrun(m_machines[index], duration);
+			}
+			break;
+		}
+	} while (done < limit);
+
+	if (elapsed > m_maxRun) {
+		m_maxRun = elapsed;
+	}
+	return done;
+}
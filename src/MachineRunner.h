@@ -0,0 +1,63 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_MACHINE_RUNNER_H
+#define AGILE_MACHINE_RUNNER_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+// Called when a call of run() exceeds the budget (machine executed last and duration of its execute() in microseconds)
+using overrun_cb = void (*)(StateMachine *fsm, uint32_t duration);
+
+/*
+* Cooperative runner of many machines with a time budget for each call of run().
+* Machines are executed in round robin: when the budget (or the max number of machines) is used,
+* the next call resumes from the next machine, so the latency of loop() doesn't grow with the number of machines.
+* The duration of execute() of each machine (callbacks and trigger conditions included) is measured with micros().
+*/
+class MachineRunner
+{
+public:
+	MachineRunner(StateMachine *const *machines, uint8_t count, uint32_t budget);
+
+	template <uint8_t N>
+	MachineRunner(StateMachine *const (&machines)[N], uint32_t budget) : MachineRunner(machines, N, budget) {}
+
+	~MachineRunner() { delete[] m_maxDuration; }
+
+	// Execute machines until budget (microseconds) is used: returns the number of machines executed (at least one)
+	uint8_t run();
+
+	void setBudget(uint32_t budget) { m_budget = budget; }
+
+	// Max number of machines executed in a call of run() (0 = no limit)
+	void setMaxMachines(uint8_t count) { m_maxMachines = count; }
+
+	void setOverrunHandler(overrun_cb handler) { m_onOverrun = handler; }
+
+	// Longest execute() of machine with given index (microseconds)
+	uint32_t getMaxDuration(uint8_t index) const { return index < m_count ? m_maxDuration[index] : 0; }
+
+	// Longest call of run() (microseconds)
+	uint32_t getMaxRunDuration() const { return m_maxRun; }
+
+	// Calls of run() that exceeded the budget
+	uint32_t getOverruns() const { return m_overruns; }
+
+	void resetStats();
+
+private:
+	StateMachine *const *m_machines;
+	uint8_t m_count;
+	uint8_t m_next = 0;
+	uint8_t m_maxMachines = 0;
+	uint32_t m_budget;
+	overrun_cb m_onOverrun = nullptr;
+
+	uint32_t *m_maxDuration;
+	uint32_t m_maxRun = 0;
+	uint32_t m_overruns = 0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef AGILE_OUTPUT_SINK_H
+#define AGILE_OUTPUT_SINK_H
+#include "Arduino.h"
+#include "ActionWord.h"
+#pragma once
+
+/*
+* Output sink: bit-packed actions write to the image word of the sink, and the
+* State Machine flushes the image to the hardware once per tick (only if changed).
+*/
+class OutputSink
+{
+public:
+	virtual ~OutputSink(){};
+
+	// The image of outputs driven by actions
+	action_word_t &image() { return m_image; }
+
+	// Write the image to the outputs if something has changed since last flush
+	void flush()
+	{
+		if (m_image != m_written)
+		{
+			write(m_image, m_image ^ m_written);
+			m_written = m_image;
+		}
+	}
+
+protected:
+	// Write value of changed bits to the outputs
+	virtual void write(action_word_t value, action_word_t changed) = 0;
+
+	action_word_t m_image = 0;
+	action_word_t m_written = 0;
+};
+
+// Bits of image are the bits of a port register (i.e. PORTB on AVR): one register write for each flush
+template <typename T>
+class PortSink : public OutputSink
+{
+public:
+	PortSink(volatile T &reg) : m_reg(&reg) {}
+
+protected:
+	void write(action_word_t value, action_word_t changed) override
+	{
+		*m_reg = (*m_reg & ~(T)changed) | ((T)value & (T)changed);
+	}
+
+	volatile T *m_reg;
+};
+
+// Bit n of image drives the pin pins[n] with digitalWrite()
+class PinSink : public OutputSink
+{
+public:
+	PinSink(const uint8_t *pins, uint8_t count) : m_pins(pins), m_count(count) {}
+
+protected:
+	void write(action_word_t value, action_word_t changed) override
+	{
+		for (uint8_t i = 0; i < m_count; i++)
+		{
+			if (changed & ((action_word_t)1 << i))
+				digitalWrite(m_pins[i], (value >> i) & 1 ? HIGH : LOW);
+		}
+	}
+
+	const uint8_t *m_pins;
+	uint8_t m_count;
+};
+
+// Sink without hardware (for testing on host): keeps last written value and number of writes
+class MockSink : public OutputSink
+{
+public:
+	action_word_t getValue() const { return m_value; }
+	uint32_t getWrites() const { return m_writes; }
+
+protected:
+	void write(action_word_t value, action_word_t) override
+	{
+		m_value = value;
+		m_writes++;
+	}
+
+	action_word_t m_value = 0;
+	uint32_t m_writes = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "Simulator.h"
+
+uint32_t Simulator::s_time = 0;
+
+
+void Simulator::logState() {
+	if (m_log != nullptr) {
+		m_log->print(s_time);
+		m_log->print(' ');
+		m_fsm.getCurrentState()->printName(*m_log);
+		m_log->println();
+	}
+}
+
+
+uint32_t Simulator::run(uint32_t duration) {
+	uint32_t transitions = 0;
+	uint16_t event = 0;
+	m_steps = 0;
+	s_time = 0;
+
+	// The outputs changed by the actions are needed to know when the transitions must be evaluated again
+	const bool writeOnChange = m_fsm.isWriteOnChange();
+	m_fsm.setWriteOnChange(true);
+
+	AgileClock::setSource(Simulator::now);
+	m_fsm.start();
+	logState();
+
+	while (true) {
+		// Apply the inputs recorded until now
+		for (; event < m_count && m_events[event].time <= s_time; event++) {
+			*m_events[event].input = m_events[event].value;
+		}
+		CachedCondition::nextTick();
+
+		// Run the machine until it's stable in this instant
+		uint8_t steps = 0;
+		bool changed = false;
+		for (; steps < AGILE_SIM_MAX_STEPS; steps++) {
+			m_steps++;
+			if (!m_fsm.execute()) {
+				changed = m_fsm.getChangedCount() > 0 || m_fsm.isChangeOverflow();
+				break;
+			}
+			transitions++;
+			logState();
+		}
+
+		if (steps == AGILE_SIM_MAX_STEPS && m_log != nullptr) {
+			m_log->print(s_time);
+			m_log->println(F(" livelock"));
+		}
+
+		// Jump to the first of next input change and next deadline of the machine
+		uint32_t deadline = m_fsm.getNextDeadline();
+		uint32_t next = (deadline > UINT32_MAX - s_time) ? UINT32_MAX : s_time + deadline;
+		if (event < m_count && m_events[event].time < next) {
+			next = m_events[event].time;
+		}
+		// Outputs written by the actions of the stable step can trigger a transition at the next tick, as on the board
+		if (next <= s_time || changed) {
+			next = s_time + 1;
+		}
+		if (next > duration) {
+			break;
+		}
+		s_time = next;
+	}
+
+	AgileClock::setSource(nullptr);
+	m_fsm.setWriteOnChange(writeOnChange);
+	return transitions;
+}
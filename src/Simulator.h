@@ -0,0 +1,69 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_SIMULATOR_H
+#define AGILE_SIMULATOR_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+// Max number of execute() in the same instant before reporting a livelock
+#ifndef AGILE_SIM_MAX_STEPS
+#define AGILE_SIM_MAX_STEPS 32
+#endif
+
+// Change of an input variable in a recorded trace (time in milliseconds from the start of simulation)
+struct SimEvent
+{
+	uint32_t time;
+	bool *input;
+	bool value;
+};
+
+/*
+* Deterministic replay of input traces with a virtual clock.
+* Instead of running every millisecond, the simulation jumps directly to the next event
+* of the trace or to the next deadline of the machine (min/max time, timed transitions, L/D actions),
+* so hours of recorded inputs are replayed in a few milliseconds.
+* Each transition is printed on log as "time state name" (easy to compare with diff).
+*/
+class Simulator
+{
+public:
+	Simulator(StateMachine &fsm) : m_fsm(fsm) {}
+
+	// Recorded inputs (sorted by time)
+	void setTrace(const SimEvent *events, uint16_t count)
+	{
+		m_events = events;
+		m_count = count;
+	}
+
+	template <uint16_t N>
+	void setTrace(const SimEvent (&events)[N]) { setTrace(events, N); }
+
+	// Output for the transitions log
+	void setLog(Print &log) { m_log = &log; }
+
+	// Start the machine at virtual time 0 and run until given time: returns the number of transitions
+	uint32_t run(uint32_t duration);
+
+	// Number of execute() done by last run()
+	uint32_t getSteps() const { return m_steps; }
+
+	// Virtual time (milliseconds)
+	static uint32_t now() { return s_time; }
+
+private:
+	void logState();
+
+	StateMachine &m_fsm;
+	const SimEvent *m_events = nullptr;
+	uint16_t m_count = 0;
+	Print *m_log = nullptr;
+	uint32_t m_steps = 0;
+
+	static uint32_t s_time;
+};
+
+#endif
@@ -1,87 +1,415 @@
 #include "State.h"
 
-Transition *State::addTransition(State *out, bool &trigger)
+#if !defined(AGILE_SM_HEADER_ONLY) || defined(AGILE_SM_IMPLEMENTATION)
+
+AGILE_SM_INLINE Transition *State::addTransition(State *out, bool &trigger)
 {
     Transition *tr = new Transition(out, trigger);
     m_transitions.append(tr);
     return tr;
 }
 
-Transition *State::addTransition(State *out, condition_cb trigger)
+AGILE_SM_INLINE Transition *State::addTransition(State *out, condition_cb trigger)
 {
     Transition *tr = new Transition(out, trigger);
     m_transitions.append(tr);
     return tr;
 }
-Transition *State::addTransition(State *out, uint32_t timeout)
+AGILE_SM_INLINE Transition *State::addTransition(State *out, uint32_t timeout)
 {
     Transition *tr = new Transition(out, timeout);
     m_transitions.append(tr);
     return tr;
 }
 
-void State::addTransition(Transition &transition)
+AGILE_SM_INLINE Transition *State::addTransition(State *out, guard_cb guard)
+{
+    Transition *tr = new Transition(out, guard);
+    m_transitions.append(tr);
+    return tr;
+}
+
+AGILE_SM_INLINE Transition *State::addTransition(State *out, CachedCondition &condition)
+{
+    Transition *tr = new Transition(out, condition);
+    m_transitions.append(tr);
+    return tr;
+}
+
+AGILE_SM_INLINE Transition *State::addTransition(State *out, AgileEvent event)
+{
+    Transition *tr = new Transition(out, event);
+    m_transitions.append(tr);
+    return tr;
+}
+
+AGILE_SM_INLINE void State::addTransition(Transition &transition)
 {
     m_transitions.append(&transition);
 }
 
-Action *State::addAction(uint8_t type, bool &target, uint32_t _time)
+AGILE_SM_INLINE Action *State::addAction(uint8_t type, bool &target, uint32_t _time)
 {
     Action *action = new Action(this, type, &target, _time);
     m_actions.append(action);
     return action;
 }
 
-void State::addAction(Action &action)
+AGILE_SM_INLINE void State::addAction(Action &action)
 {
+    action.m_state = this;
     m_actions.append(&action);
 }
 
-State *State::runTransitions()
+AGILE_SM_INLINE ActionWord *State::addAction(uint8_t type, action_word_t &target, action_word_t mask, uint32_t _time)
+{
+    // All the actions on the same word share the same masks
+    ActionWord *word = m_actionWords;
+    while (word != nullptr && word->getTarget() != &target)
+        word = word->m_next;
+
+    if (word == nullptr)
+    {
+        word = new ActionWord(target);
+        addAction(*word);
+    }
+    if (!word->addAction(type, mask, _time))
+        return nullptr;
+    return word;
+}
+
+AGILE_SM_INLINE ActionWord *State::addAction(uint8_t type, OutputSink &sink, action_word_t mask, uint32_t _time)
+{
+    ActionWord *word = addAction(type, sink.image(), mask, _time);
+    if (word != nullptr)
+        word->m_sink = &sink;
+    return word;
+}
+
+AGILE_SM_INLINE void State::addAction(ActionWord &word)
+{
+    word.m_next = m_actionWords;
+    m_actionWords = &word;
+}
+
+AGILE_SM_INLINE ActionRamp *State::addRamp(ramp_t &target, ramp_t setpoint, uint32_t rate)
+{
+    ActionRamp *ramp = new ActionRamp(target, setpoint, rate);
+    addRamp(*ramp);
+    return ramp;
+}
+
+AGILE_SM_INLINE void State::addRamp(ActionRamp &ramp)
+{
+    ramp.m_next = m_ramps;
+    m_ramps = &ramp;
+}
+
+AGILE_SM_HOT Transition *State::runTransitions(uint32_t now, conflict_cb onConflict, uint8_t count, int16_t event)
 {
+    const uint8_t total = m_transitions.size();
+    if (total == 0)
+        return nullptr;
+
+    // Only count transitions for each call, starting from where the previous call has stopped
+    if (onConflict == nullptr && count > 0 && count < total)
+    {
+        Transition *tr = (m_nextTransition != nullptr) ? m_transitions.resume(m_nextTransition) : m_transitions.first();
+        for (uint8_t n = 0; n < count; n++)
+        {
+            if (tr->trigger(m_enterTime, now, this, event))
+                return tr;
+
+            tr = m_transitions.next();
+            if (tr == nullptr)
+                tr = m_transitions.first();
+        }
+        m_nextTransition = m_transitions.position();
+        return nullptr;
+    }
+
+    if (onConflict == nullptr)
+    {
+        for (Transition *tr = m_transitions.first(); tr != nullptr; tr = m_transitions.next())
+        {
+            // Pass m_enterTime to activate transition on timeout (if defined)
+            if (tr->trigger(m_enterTime, now, this, event))
+            {
+                return tr;
+            }
+        }
+        return nullptr;
+    }
+
+    // Conflicts detection: all transitions are evaluated (the handler can inspect the state, the iteration is resumed after it)
+    Transition *taken = nullptr;
     for (Transition *tr = m_transitions.first(); tr != nullptr; tr = m_transitions.next())
     {
-        // Pass m_enterTime to activate transition on timeout (if defined)
-        if (tr->trigger(m_enterTime))
+        if (tr->trigger(m_enterTime, now, this, event))
         {
-            return tr->getOutputState();
+            if (taken == nullptr)
+                taken = tr;
+            else
+            {
+                ListNode<Transition *> *position = m_transitions.position();
+                onConflict(this, taken, tr);
+                m_transitions.resume(position);
+            }
         }
     }
-    return nullptr;
+    return taken;
 }
 
-void State::runActions()
+// Stable sort of transitions by priority (done once by start(), so execute() is still a linear scan)
+AGILE_SM_INLINE void State::sortTransitions()
 {
-    for (Action *action = m_actions.first(); action != nullptr; action = m_actions.next())
+    const uint8_t count = m_transitions.size();
+    if (count < 2)
+        return;
+
+    bool sorted = true;
+    uint8_t priority = m_transitions.first()->getPriority();
+    for (Transition *tr = m_transitions.next(); tr != nullptr && sorted; tr = m_transitions.next())
+    {
+        sorted = priority >= tr->getPriority();
+        priority = tr->getPriority();
+    }
+    if (sorted)
+        return;
+
+    Transition **order = new Transition *[count];
+    uint8_t i = 0;
+    for (Transition *tr = m_transitions.first(); tr != nullptr; tr = m_transitions.next(), i++)
+    {
+        uint8_t j = i;
+        for (; j > 0 && order[j - 1]->getPriority() < tr->getPriority(); j--)
+            order[j] = order[j - 1];
+        order[j] = tr;
+    }
+
+    m_transitions.clear();
+    m_nextTransition = nullptr;
+    for (i = 0; i < count; i++)
+        m_transitions.append(order[i]);
+    delete[] order;
+}
+
+// Time left before the first of min time, max time, timed transitions, L/D/P actions or ramps expires
+AGILE_SM_INLINE uint32_t State::getTimeToDeadline(uint32_t now)
+{
+    const uint32_t elapsed = now - m_enterTime;
+    uint32_t deadline = UINT32_MAX;
+
+    for (ActionWord *word = m_actionWords; word != nullptr; word = word->m_next)
+        deadline = min(deadline, word->getTimeToDeadline(elapsed));
+
+    for (ActionRamp *ramp = m_ramps; ramp != nullptr; ramp = ramp->m_next)
+        deadline = min(deadline, ramp->getTimeToDeadline(elapsed));
+
+    if (m_actions.size() > 0)
     {
-        action->execute();
+        for (Action *action = m_actions.first(); action != nullptr; action = m_actions.next())
+            deadline = min(deadline, action->getTimeToDeadline(now));
     }
+
+    if (elapsed < m_minTime)
+        deadline = min(deadline, m_minTime - elapsed);
+
+    if (m_hooks != nullptr && m_hooks->deadline != nullptr)
+        deadline = min(deadline, m_hooks->deadline(this, now));
+
+    if (m_maxTime > 0 && !m_timeout)
+        deadline = min(deadline, elapsed < m_maxTime ? m_maxTime - elapsed : 0);
+
+    if (m_transitions.size() == 0)
+        return deadline;
+
+    for (Transition *tr = m_transitions.first(); tr != nullptr; tr = m_transitions.next())
+    {
+        // Timed transitions can't fire before the min time
+        uint32_t timeout = tr->getTimeout();
+        if (timeout > 0 && timeout < m_minTime)
+            timeout = m_minTime;
+        if (timeout > 0)
+            deadline = min(deadline, elapsed < timeout ? timeout - elapsed : 0);
+    }
+    return deadline;
+}
+
+AGILE_SM_HOT void State::runActions(uint32_t now, uint32_t elapsed, OutputChanges *changes)
+{
+    // Write on change: nothing to do until state entry, a timer of actions or the end of a rising edge
+    if (changes != nullptr && !m_firstRun && elapsed < m_actionsDue)
+        return;
+
+    bool edge = false;
+    for (ActionWord *word = m_actionWords; word != nullptr; word = word->m_next)
+    {
+        word->execute(elapsed, m_firstRun);
+        if (word->m_sink != nullptr)
+            word->m_sink->flush();
+        edge |= m_firstRun && word->m_re;
+    }
+    for (ActionRamp *ramp = m_ramps; ramp != nullptr; ramp = ramp->m_next)
+        ramp->execute(elapsed);
+    m_firstRun = false;
+
+    Action *first = (m_actions.size() > 0) ? m_actions.first() : nullptr;
+    if (changes == nullptr)
+    {
+        for (Action *action = first; action != nullptr; action = m_actions.next())
+            action->execute(now);
+        return;
+    }
+
+    for (Action *action = first; action != nullptr; action = m_actions.next())
+    {
+        const bool before = *action->m_actionTarget;
+        action->execute(now);
+        if (*action->m_actionTarget != before)
+            changes->add(action->m_actionTarget, before);
+        edge |= action->m_actionType == Action::Type::RE && *action->m_actionTarget;
+    }
+
+    // Next evaluation: next tick to end a rising edge, otherwise the first timer of L/D/P actions or step of ramps
+    uint32_t due = UINT32_MAX;
+    if (!edge)
+    {
+        for (ActionWord *word = m_actionWords; word != nullptr; word = word->m_next)
+            due = min(due, word->getTimeToDeadline(elapsed));
+        for (ActionRamp *ramp = m_ramps; ramp != nullptr; ramp = ramp->m_next)
+            due = min(due, ramp->getTimeToDeadline(elapsed));
+        for (Action *action = (first != nullptr) ? m_actions.first() : nullptr; action != nullptr; action = m_actions.next())
+            due = min(due, action->getTimeToDeadline(now));
+    }
+    else
+        due = 0;
+    m_actionsDue = (due > UINT32_MAX - elapsed) ? UINT32_MAX : elapsed + due;
 }
 
-void State::clearActions()
+AGILE_SM_INLINE void State::clearActions(OutputChanges *changes)
 {
+    // Ramps keep the value reached
+    for (ActionRamp *ramp = m_ramps; ramp != nullptr; ramp = ramp->m_next)
+        ramp->clear();
+
+    for (ActionWord *word = m_actionWords; word != nullptr; word = word->m_next)
+    {
+        word->clear();
+        if (word->m_sink != nullptr)
+            word->m_sink->flush();
+    }
+
+    if (m_actions.size() == 0)
+        return;
+
     for (Action *action = m_actions.first(); action != nullptr; action = m_actions.next())
     {
+        const bool before = *action->m_actionTarget;
         action->clear();
+        if (changes != nullptr && *action->m_actionTarget != before)
+            changes->add(action->m_actionTarget, before);
+    }
+}
+
+// Value of target after clear() of an action (-1 if not changed)
+static inline int8_t restValue(uint8_t type)
+{
+    switch (type)
+    {
+    case Action::Type::N:
+    case Action::Type::L:
+    case Action::Type::D:
+    case Action::Type::RE:
+    case Action::Type::P:
+        return 0;
+    case Action::Type::FE:
+        return 1;
     }
+    return -1;
 }
 
-uint8_t State::getActions()
+// Outputs of the state are at rest value (as set by clearActions())
+AGILE_SM_INLINE bool State::actionsCleared()
+{
+    for (ActionWord *word = m_actionWords; word != nullptr; word = word->m_next)
+    {
+        const action_word_t reset = (word->m_n | word->m_l | word->m_d | word->m_re | word->m_p) & ~word->m_fe;
+        if ((*word->m_target & reset) != 0 || (*word->m_target & word->m_fe) != word->m_fe)
+            return false;
+    }
+
+    // Actions are cleared in order: with more actions on the same target, the last one sets the rest value
+    for (uint8_t i = 0; i < m_actions.size(); i++)
+    {
+        Action *action = m_actions.get(i);
+        int8_t rest = restValue(action->getType());
+        for (uint8_t j = i + 1; j < m_actions.size() && rest >= 0; j++)
+        {
+            Action *other = m_actions.get(j);
+            if (other->getTarget() == action->getTarget() && restValue(other->getType()) >= 0)
+                rest = -1;
+        }
+        if (rest >= 0 && *action->getTarget() != (rest == 1))
+            return false;
+    }
+    return true;
+}
+
+AGILE_SM_INLINE uint8_t State::getActions()
 {
     return m_actions.size();
 }
 
-void State::setIndex(uint8_t index)
+AGILE_SM_INLINE size_t State::printName(Print &out) const
+{
+#ifndef AGILE_SM_NO_NAMES
+    if (m_stateName == nullptr)
+        return out.print(m_stateIndex);
+    if (m_flashName)
+        return out.print(getStateName_P());
+    return out.print(m_stateName);
+#else
+    return out.print(m_stateIndex);
+#endif
+}
+
+#ifdef AGILE_SM_NO_NAMES
+AGILE_SM_INLINE State::State(NoName, uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run)
+    : m_minTime(min),
+      m_maxTime(max),
+      m_onEntering(enter),
+      m_onLeaving(exit),
+      m_onRunning(run)
+{
+}
+
+AGILE_SM_INLINE const char *State::getStateName() const
+{
+    static char id[4];
+    uint8_t value = m_stateIndex;
+    uint8_t len = (value >= 100) ? 3 : (value >= 10) ? 2 : 1;
+    id[len] = '\0';
+    do
+    {
+        id[--len] = '0' + value % 10;
+        value /= 10;
+    } while (len > 0);
+    return id;
+}
+#endif
+
+AGILE_SM_INLINE void State::setIndex(uint8_t index)
 {
     m_stateIndex = index;
 }
 
-uint8_t State::getIndex() const
+AGILE_SM_INLINE uint8_t State::getIndex() const
 {
     return m_stateIndex;
 }
 
-void State::setTimeout(uint32_t _time)
+AGILE_SM_INLINE void State::setTimeout(uint32_t _time)
 {
     if (_time)
     {
@@ -89,27 +417,42 @@ void State::setTimeout(uint32_t _time)
     }
 }
 
-bool State::getTimeout()
+AGILE_SM_INLINE bool State::getTimeout()
 {
-    return (millis() - m_enterTime > m_maxTime);
+    // Flag is set by StateMachine::execute(), but the state can be polled also between ticks
+    return m_timeout || (m_maxTime > 0 && AgileClock::now() - m_enterTime >= m_maxTime);
 }
 
-void State::resetEnterTime()
+AGILE_SM_INLINE void State::resetEnterTime()
 {
-    m_enterTime = millis();
+    m_enterTime = AgileClock::now();
 }
 
-uint32_t State::getEnterTime()
+AGILE_SM_INLINE uint32_t State::getEnterTime()
 {
     return m_enterTime;
 }
 
-void State::setStateMaxTime(uint32_t _time)
+AGILE_SM_INLINE void State::setStateMaxTime(uint32_t _time, State *timeoutState)
 {
     m_maxTime = _time;
+    m_timeoutState = timeoutState;
+    m_maxTimePolicy = (timeoutState != nullptr) ? MAX_TIME_TRANSITION : MAX_TIME_COUNT;
 }
 
-void State::setStateMinTime(uint32_t _time)
+AGILE_SM_INLINE void State::setStateMaxTime(uint32_t _time, MaxTimePolicy policy)
+{
+    m_maxTime = _time;
+    m_maxTimePolicy = policy;
+    // The transition policy keeps the timeout state already set
+    if (policy != MAX_TIME_TRANSITION)
+    {
+        m_timeoutState = nullptr;
+    }
+}
+
+AGILE_SM_INLINE void State::setStateMinTime(uint32_t _time)
 {
     m_minTime = _time;
-}
\ No newline at end of file
+}
+#endif
@@ -5,21 +5,113 @@
 #include "Arduino.h"
 #include "LinkedList.h"
 #include "Action.h"
+#include "ActionWord.h"
+#include "ActionRamp.h"
+#include "OutputSink.h"
 #include "Transition.h"
 
 class Transition;
 class Action;
+class StateGroup;
 
 using state_cb = void (*)();
 
+// Handler of a state active beyond its max time (see StateMachine::setStallHandler())
+using stall_cb = void (*)(State *state, uint32_t elapsed);
+
+// Release builds: with AGILE_SM_NO_NAMES states have no name, only their index as ID (see extras/state_names.py).
+// Constructors taking a name are forced inline, so the unused string literals are not stored in the program
+// Header-only builds (add -DAGILE_SM_HEADER_ONLY to build flags): the definitions of State.cpp and AgileStateMachine.cpp
+// are included by the headers as inline functions, so execute() can be inlined with the calls of the engine without LTO.
+// Not single-include: the .cpp files of src are still compiled as translation units (static data and the other modules)
+#ifdef AGILE_SM_HEADER_ONLY
+#define AGILE_SM_INLINE inline
+#else
+#define AGILE_SM_INLINE
+#endif
+
+// Functions of the execute() path forced inline in header-only builds (the compiler would keep them apart)
+#if defined(AGILE_SM_HEADER_ONLY) && defined(__GNUC__)
+#define AGILE_SM_HOT __attribute__((always_inline)) inline
+#else
+#define AGILE_SM_HOT
+#endif
+
+#if defined(AGILE_SM_NO_NAMES) && defined(__GNUC__)
+#define AGILE_SM_NAME_INLINE __attribute__((always_inline)) inline
+#else
+#define AGILE_SM_NAME_INLINE
+#endif
+
+// Max number of outputs reported as changed by an execute() (see StateMachine::setWriteOnChange())
+#ifndef AGILE_SM_CHANGED_OUTPUTS
+#define AGILE_SM_CHANGED_OUTPUTS 8
+#endif
+
+// Outputs (bool targets of actions) changed during a tick, with the value they had before
+struct OutputChanges
+{
+    bool *target[AGILE_SM_CHANGED_OUTPUTS];
+    bool before[AGILE_SM_CHANGED_OUTPUTS];
+    uint8_t count = 0;
+    bool overflow = false;
+
+    void add(bool *output, bool value)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (target[i] == output)
+                return;
+        }
+        if (count < AGILE_SM_CHANGED_OUTPUTS)
+        {
+            target[count] = output;
+            before[count++] = value;
+        }
+        else
+            overflow = true;
+    }
+};
+
+// Handlers of a state that need the state object (filled at compile time by StateImpl)
+struct StateHooks
+{
+    void (*enter)(State *);
+    void (*exit)(State *);
+    void (*run)(State *);
+    uint32_t (*deadline)(State *, uint32_t now);    // Time to the next wake up of the handlers (UINT32_MAX if none)
+};
+
+/*
+* Calls of the state handlers made by StateMachine::execute(): callback functions and hooks of the state.
+* StateMachine::execute<States...>() uses the specialization of StateImpl.h, that calls directly the handlers of the classes listed
+*/
+template <class... States>
+struct StateDispatch
+{
+    static void enter(State *state);
+    static void exit(State *state);
+    static void run(State *state);
+};
+
 class State
 {
 public:
     ~State() = default;
 
+    // What the engine does when the state is active beyond its max time (the violation is always counted)
+    enum MaxTimePolicy : uint8_t
+    {
+        MAX_TIME_COUNT,         // Only the timeout flag and the count
+        MAX_TIME_HANDLER,       // Call the handler of the machine, the state remains active
+        MAX_TIME_TRANSITION     // Go to the timeout state
+    };
+
+#ifndef AGILE_SM_NO_NAMES
     template <typename T>
     State(T name, uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run)
         : m_stateName(reinterpret_cast<const char *>(name)),
+          m_flashName(isFlashString(name)),
           m_minTime(min),
           m_maxTime(max),
           m_onEntering(enter),
@@ -27,31 +119,54 @@ public:
           m_onRunning(run)
     {
     }
+#else
+    // The name is dropped here, the constructor called is not inline
+    struct NoName
+    {
+    };
+    State(NoName, uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run);
+
+    template <typename T>
+    AGILE_SM_NAME_INLINE State(T, uint32_t min, uint32_t max, state_cb enter, state_cb exit, state_cb run)
+        : State(NoName(), min, max, enter, exit, run) {}
+#endif
 
     // Delegazione ai costruttori principali
     template <typename T>
-    State(T name)
+    AGILE_SM_NAME_INLINE State(T name)
         : State(name, 0, 0, nullptr, nullptr, nullptr) {}
 
     template <typename T>
-    State(T name, uint32_t min, uint32_t max)
+    AGILE_SM_NAME_INLINE State(T name, uint32_t min, uint32_t max)
         : State(name, min, max, nullptr, nullptr, nullptr) {}
 
     template <typename T>
-    State(T name, state_cb enter, state_cb exit, state_cb run)
+    AGILE_SM_NAME_INLINE State(T name, state_cb enter, state_cb exit = nullptr, state_cb run = nullptr)
         : State(name, 0, 0, enter, exit, run) {}
 
     template <typename T>
-    State(T name, uint32_t min, state_cb enter, state_cb exit, state_cb run)
+    AGILE_SM_NAME_INLINE State(T name, uint32_t min, state_cb enter, state_cb exit = nullptr, state_cb run = nullptr)
         : State(name, min, 0, enter, exit, run) {}
 
     void setTimeout(uint32_t preset);
     bool getTimeout();
     void resetEnterTime();
     uint32_t getEnterTime();
-    void setStateMaxTime(uint32_t _time);
+    void setStateMaxTime(uint32_t _time, State *timeoutState = nullptr);
+    void setStateMaxTime(uint32_t _time, MaxTimePolicy policy);
     void setStateMinTime(uint32_t _time);
+    uint8_t getMaxTimePolicy() const { return m_maxTimePolicy; }
+
+    // Health of the state: times it was active beyond max time and longest stay (ms) since last reset
+    uint16_t getViolations() const { return m_violations; }
+    uint32_t getLongestStay() const { return m_longestStay; }
+    void resetHealth()
+    {
+        m_violations = 0;
+        m_longestStay = 0;
+    }
 
+#ifndef AGILE_SM_NO_NAMES
     const char *getStateName() const
     {
         return m_stateName;
@@ -62,38 +177,172 @@ public:
         return reinterpret_cast<const __FlashStringHelper *>(m_stateName);
     }
 
+    // True if name was passed with F() macro
+    bool isNameInFlash() const { return m_flashName; }
+#else
+    // ID of the state as text, in a buffer shared by all states (valid until the next call of any state):
+    // printName() is the way to print the name in both configurations
+    const char *getStateName() const;
+    const char *getStateName_P() const { return getStateName(); }
+    bool isNameInFlash() const { return false; }
+#endif
+
+    // Print the name of state (stored in RAM or flash memory), the ID if it has no name
+    size_t printName(Print &out) const;
+
+    // Inspection of transitions and actions (index in the order of evaluation: after start() transitions are sorted by priority)
+    uint8_t getTransitionsNumber() { return m_transitions.size(); }
+    Transition *getTransition(uint8_t index) { return m_transitions.get(index); }
+    uint8_t getActionsNumber() { return m_actions.size(); }
+    Action *getAction(uint8_t index) { return m_actions.get(index); }
+    State *getTimeoutState() const { return m_timeoutState; }
+    uint32_t getStateMinTime() const { return m_minTime; }
+    uint32_t getStateMaxTime() const { return m_maxTime; }
+
     Transition *addTransition(State *out, bool &trigger);
     Transition *addTransition(State *out, condition_cb trigger);
     Transition *addTransition(State *out, uint32_t timeout);
+    Transition *addTransition(State *out, guard_cb guard);
+    Transition *addTransition(State *out, CachedCondition &condition);
+    Transition *addTransition(State *out, AgileEvent event);
     void addTransition(Transition &transition);
 
     Action *addAction(uint8_t type, bool &target, uint32_t _time = 0);
     void addAction(Action &action);
 
+    // Bit-packed actions: bits of mask in target word are driven by the state
+    // (nullptr if an L, D or P time differs from the one already set for the same word)
+    ActionWord *addAction(uint8_t type, action_word_t &target, action_word_t mask, uint32_t _time = 0);
+    void addAction(ActionWord &word);
+
+    // Bit-packed actions bound to an output sink (pins or port register written directly by the machine)
+    ActionWord *addAction(uint8_t type, OutputSink &sink, action_word_t mask, uint32_t _time = 0);
+
+    // Ramp of target toward setpoint while the state is active (rate in units per second)
+    ActionRamp *addRamp(ramp_t &target, ramp_t setpoint, uint32_t rate);
+    void addRamp(ActionRamp &ramp);
+
     void setIndex(uint8_t index);
     uint8_t getIndex() const;
 
+    // Publish event on bus every time the state is entered (after the OnEntering() callback)
+    void emitOnEnter(EventBus &bus, AgileEvent event, const void *payload = nullptr)
+    {
+        m_emitBus = &bus;
+        m_emitEvent = event.id;
+        m_emitPayload = payload;
+    }
+
+    // Group of the state (nullptr if none) and true if this is the history of the group
+    StateGroup *getGroup() const { return m_group; }
+    bool isHistory() const { return m_isHistory; }
+
 protected:
     friend class StateMachine;
     friend class Transition;
+    friend class StateGroup;
+    template <class... States>
+    friend struct StateDispatch;
+
+    static bool isFlashString(const __FlashStringHelper *) { return true; }
+    static bool isFlashString(const char *) { return false; }
 
+#ifndef AGILE_SM_NO_NAMES
     const char *m_stateName;
+    bool m_flashName = false;
+#endif
     uint32_t m_minTime = 0;
     uint32_t m_maxTime = 0;
-    uint32_t m_enterTime;
+    uint32_t m_enterTime = 0;
     state_cb m_onEntering = nullptr;
     state_cb m_onLeaving = nullptr;
     state_cb m_onRunning = nullptr;
 
+    State *m_timeoutState = nullptr;
+    const StateHooks *m_hooks = nullptr;
+    StateGroup *m_group = nullptr;
+    bool m_isHistory = false;
+    EventBus *m_emitBus = nullptr;
+    const void *m_emitPayload = nullptr;
+    uint8_t m_emitEvent = 0;
+
     uint8_t m_stateIndex = 0;
     bool m_timeout = false;
+    uint8_t m_maxTimePolicy = MAX_TIME_COUNT;
+    uint16_t m_violations = 0;
+    uint32_t m_longestStay = 0;
+    bool m_firstRun = false;
+    ListNode<Transition *> *m_nextTransition = nullptr;     // Next transition to evaluate with a limit per tick (nullptr = first)
+    uint32_t m_actionsDue = 0;   // Elapsed time of next evaluation of actions (write on change)
     LinkedList<Transition *> m_transitions;
     LinkedList<Action *> m_actions;
+    ActionWord *m_actionWords = nullptr;
+    ActionRamp *m_ramps = nullptr;
+
+    // Callback functions or hooks of the state (called by StateMachine).
+    // States with hooks (StateImpl, CoState) have no callback functions: the hooks are checked only when there is no callback
+    void callOnEntering()
+    {
+        if (m_onEntering != nullptr)
+            m_onEntering();
+        else if (m_hooks != nullptr && m_hooks->enter != nullptr)
+            m_hooks->enter(this);
+        publishOnEnter();
+    }
+
+    void publishOnEnter()
+    {
+        if (m_emitBus != nullptr)
+            m_emitBus->publish(AgileEvent(m_emitEvent), m_emitPayload);
+    }
+
+    void callOnLeaving()
+    {
+        if (m_onLeaving != nullptr)
+            m_onLeaving();
+        else if (m_hooks != nullptr && m_hooks->exit != nullptr)
+            m_hooks->exit(this);
+    }
+
+    void callOnRunning()
+    {
+        if (m_onRunning != nullptr)
+            m_onRunning();
+        else if (m_hooks != nullptr && m_hooks->run != nullptr)
+            m_hooks->run(this);
+    }
 
-    State *runTransitions();
-    void runActions();
-    void clearActions();
+    Transition *runTransitions(uint32_t now, conflict_cb onConflict = nullptr, uint8_t count = 0, int16_t event = -1);
+    void sortTransitions();
+    uint32_t getTimeToDeadline(uint32_t now);
+    void runActions(uint32_t now, uint32_t elapsed, OutputChanges *changes = nullptr);
+    void clearActions(OutputChanges *changes = nullptr);
+    bool actionsCleared();
     uint8_t getActions();
 };
 
+template <class... States>
+inline void StateDispatch<States...>::enter(State *state)
+{
+    state->callOnEntering();
+}
+
+template <class... States>
+inline void StateDispatch<States...>::exit(State *state)
+{
+    state->callOnLeaving();
+}
+
+template <class... States>
+inline void StateDispatch<States...>::run(State *state)
+{
+    state->callOnRunning();
+}
+
+#ifdef AGILE_SM_HEADER_ONLY
+#define AGILE_SM_IMPLEMENTATION
+#include "State.cpp"
+#undef AGILE_SM_IMPLEMENTATION
+#endif
+
 #endif
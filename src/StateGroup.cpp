@@ -0,0 +1,29 @@
+#include "StateGroup.h"
+
+StateGroup::StateGroup(State *initial, uint8_t mode) : m_history("History"), m_initial(initial), m_mode(mode) {
+	m_history.m_group = this;
+	m_history.m_isHistory = true;
+	add(initial);
+}
+
+
+void StateGroup::add(State *state) {
+	state->m_group = this;
+}
+
+
+void StateGroup::save(State *state, uint32_t elapsed) {
+	m_last = state;
+	m_elapsed = elapsed;
+}
+
+
+State *StateGroup::resume(uint32_t now, uint32_t &enterTime) {
+	if (m_last == nullptr) {
+		enterTime = now;
+		return m_initial;
+	}
+
+	enterTime = (m_mode == RESUME_TIME) ? now - m_elapsed : now;
+	return m_last;
+}
@@ -0,0 +1,55 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_STATE_GROUP_H
+#define AGILE_STATE_GROUP_H
+#include "Arduino.h"
+#include "State.h"
+
+/*
+* Group of states that can be left (i.e. to handle an interruption) and resumed later.
+* A transition to history() enters the last active state of the group (the initial state if never left):
+* SHALLOW enters it again from the start, RESUME_TIME resumes it with the elapsed time preserved
+* (min/max time and timed transitions continue from where they were, L/D actions start again).
+* Groups are not nested: this is not the deep history of UML, only the time of the last state is kept.
+*/
+class StateGroup
+{
+public:
+	enum Mode : uint8_t
+	{
+		SHALLOW,
+		RESUME_TIME
+	};
+
+	StateGroup(State *initial, uint8_t mode = SHALLOW);
+
+	// Add a state to the group (the initial state is already added)
+	void add(State *state);
+
+	// Target of the transitions that resume the group
+	State *history() { return &m_history; }
+
+	State *getInitialState() const { return m_initial; }
+
+	// Last active state of the group (nullptr if never left)
+	State *getLastState() const { return m_last; }
+
+	// Forget the last active state: the next resume enters the initial state
+	void reset() { m_last = nullptr; }
+
+private:
+	friend class StateMachine;
+
+	void save(State *state, uint32_t elapsed);
+	State *resume(uint32_t now, uint32_t &enterTime);
+
+	State m_history;
+	State *m_initial;
+	State *m_last = nullptr;
+	uint32_t m_elapsed = 0;
+	uint8_t m_mode;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_STATE_IMPL_H
+#define AGILE_STATE_IMPL_H
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+namespace agile_sm
+{
+	// Compile time comparison of types (type_traits is not available on every board)
+	template <typename A, typename B>
+	struct is_same { static const bool value = false; };
+
+	template <typename A>
+	struct is_same<A, A> { static const bool value = true; };
+}
+
+/*
+* State with handlers written as member functions of a class (CRTP): Derived redefines only the handlers it needs.
+*
+*   class Motor : public StateImpl<Motor> {
+*   public:
+*     Motor() : StateImpl("Motor", 500) {}
+*     void onEnter() { ... }
+*     bool isStalled() { ... }
+*   };
+*
+* Handlers are resolved at compile time and called through a static table of the class (with the state as context),
+* so the body of each handler is inlined in its thunk and the handlers not defined by Derived are never called.
+* With fsm.execute<Motor, Pump>() the engine checks the class of the active state and calls the handlers of the classes
+* listed directly, so they are inlined in execute() without indirect calls (other states are called as with execute()).
+* Guards are called through a function pointer in both cases, as the conditions of the other transitions.
+*/
+template <class Derived>
+class StateImpl : public State
+{
+public:
+	template <typename T>
+	AGILE_SM_NAME_INLINE StateImpl(T name, uint32_t min = 0, uint32_t max = 0) : State(name, min, max, nullptr, nullptr, nullptr)
+	{
+		m_hooks = &s_hooks;
+	}
+
+	// Default handlers (not called)
+	void onEnter() {}
+	void onExit() {}
+	void onRun() {}
+
+	using State::addTransition;
+
+	// Transition triggered by a member function of Derived (i.e. addTransition<&Motor::isStalled>(stAlarm))
+	template <bool (Derived::*Guard)()>
+	Transition *addTransition(State *out)
+	{
+		return State::addTransition(out, &guardThunk<Guard>);
+	}
+
+private:
+	static void enterThunk(State *state) { static_cast<Derived *>(state)->onEnter(); }
+	static void exitThunk(State *state) { static_cast<Derived *>(state)->onExit(); }
+	static void runThunk(State *state) { static_cast<Derived *>(state)->onRun(); }
+
+	template <bool (Derived::*Guard)()>
+	static bool guardThunk(State *state) { return (static_cast<Derived *>(state)->*Guard)(); }
+
+	// A handler redefined by Derived has type void (Derived::*)()
+	static const StateHooks s_hooks;
+
+	template <class... States>
+	friend struct StateDispatch;
+};
+
+template <class Derived>
+const StateHooks StateImpl<Derived>::s_hooks = {
+	agile_sm::is_same<decltype(&Derived::onEnter), void (StateImpl<Derived>::*)()>::value ? nullptr : &StateImpl<Derived>::enterThunk,
+	agile_sm::is_same<decltype(&Derived::onExit), void (StateImpl<Derived>::*)()>::value ? nullptr : &StateImpl<Derived>::exitThunk,
+	agile_sm::is_same<decltype(&Derived::onRun), void (StateImpl<Derived>::*)()>::value ? nullptr : &StateImpl<Derived>::runThunk,
+	nullptr
+};
+
+// Handlers of the first class of the list called directly when the state is of that class, the rest of the list otherwise
+template <class S, class... Rest>
+struct StateDispatch<S, Rest...>
+{
+	static bool isClass(State *state) { return state->m_hooks == &StateImpl<S>::s_hooks; }
+
+	static void enter(State *state)
+	{
+		if (isClass(state))
+		{
+			static_cast<S *>(state)->onEnter();
+			state->publishOnEnter();
+		}
+		else
+		{
+			StateDispatch<Rest...>::enter(state);
+		}
+	}
+
+	static void exit(State *state)
+	{
+		if (isClass(state))
+		{
+			static_cast<S *>(state)->onExit();
+		}
+		else
+		{
+			StateDispatch<Rest...>::exit(state);
+		}
+	}
+
+	static void run(State *state)
+	{
+		if (isClass(state))
+		{
+			static_cast<S *>(state)->onRun();
+		}
+		else
+		{
+			StateDispatch<Rest...>::run(state);
+		}
+	}
+};
+
+#endif
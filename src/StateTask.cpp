@@ -0,0 +1,148 @@
+#include "StateTask.h"
+
+#if defined(__cpp_impl_coroutine)
+#include <cstddef>
+
+// Pool of coroutine frames
+alignas(std::max_align_t) static uint8_t s_frames[AGILE_SM_TASK_FRAMES][AGILE_SM_TASK_FRAME_SIZE];
+static bool s_used[AGILE_SM_TASK_FRAMES];
+
+void *StateTask::promise_type::operator new(size_t size) noexcept {
+	if (size > AGILE_SM_TASK_FRAME_SIZE) {
+		return nullptr;
+	}
+	for (uint8_t i = 0; i < AGILE_SM_TASK_FRAMES; i++) {
+		if (!s_used[i]) {
+			s_used[i] = true;
+			return s_frames[i];
+		}
+	}
+	return nullptr;
+}
+
+
+void StateTask::promise_type::operator delete(void *frame) noexcept {
+	for (uint8_t i = 0; i < AGILE_SM_TASK_FRAMES; i++) {
+		if (frame == s_frames[i]) {
+			s_used[i] = false;
+		}
+	}
+}
+
+
+// Consume what the body is waiting for, if it's due
+bool StateTask::promise_type::isReady(uint32_t now) {
+	if (variable != nullptr) {
+		if (!*variable) {
+			return false;
+		}
+		variable = nullptr;
+	}
+	else if (condition != nullptr) {
+		if (!condition()) {
+			return false;
+		}
+		condition = nullptr;
+	}
+	else if (time > 0) {
+		if (now - start < time) {
+			return false;
+		}
+		time = 0;
+	}
+	return true;
+}
+
+
+uint8_t StateTask::getFramesUsed() {
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < AGILE_SM_TASK_FRAMES; i++) {
+		count += s_used[i];
+	}
+	return count;
+}
+
+
+StateTask &StateTask::operator=(StateTask &&other) {
+	if (this != &other) {
+		release();
+		m_handle = other.m_handle;
+		other.m_handle = nullptr;
+	}
+	return *this;
+}
+
+
+void StateTask::release() {
+	if (m_handle) {
+		m_handle.destroy();
+		m_handle = nullptr;
+	}
+}
+
+
+void StateTask::resume(uint32_t now) {
+	if (m_handle && !m_handle.done() && m_handle.promise().isReady(now)) {
+		m_handle.resume();
+	}
+}
+
+
+uint32_t StateTask::getTimeToDeadline(uint32_t now) const {
+	if (!m_handle || m_handle.done()) {
+		return UINT32_MAX;
+	}
+
+	const promise_type &p = m_handle.promise();
+	if (p.variable != nullptr || p.condition != nullptr) {
+		return UINT32_MAX;
+	}
+	const uint32_t elapsed = now - p.start;
+	return elapsed < p.time ? p.time - elapsed : 0;
+}
+
+
+const StateHooks CoState::s_hooks = {
+	&CoState::enter,
+	&CoState::exit,
+	&CoState::run,
+	&CoState::deadline
+};
+
+// The body starts again on every entry (the initial state is entered by start() without callbacks)
+void CoState::enter(State *state) {
+	CoState *co = static_cast<CoState *>(state);
+	co->m_task.release();
+	co->m_ended = false;
+}
+
+
+void CoState::exit(State *state) {
+	CoState *co = static_cast<CoState *>(state);
+	co->m_task.release();
+	co->m_ended = false;
+}
+
+
+void CoState::run(State *state) {
+	CoState *co = static_cast<CoState *>(state);
+	if (!co->m_task.isValid()) {
+		co->m_task = co->m_body();
+		AGILE_SM_CHECK(co->m_task.isValid(), "Coroutine frame not available");
+	}
+	const bool done = co->isDone();
+	co->m_task.resume(AgileClock::now());
+	co->m_ended = !done && co->isDone();
+}
+
+
+// Body not started yet (or frame not available), or just ended: the state must run at the next tick
+uint32_t CoState::deadline(State *state, uint32_t now) {
+	CoState *co = static_cast<CoState *>(state);
+	if (!co->m_task.isValid() || co->m_ended) {
+		return 0;
+	}
+	return co->m_task.getTimeToDeadline(now);
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_STATE_TASK_H
+#define AGILE_STATE_TASK_H
+
+// Coroutines need a C++20 compiler (i.e. ESP32 with -std=gnu++20, or a host build)
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include "Arduino.h"
+#include "AgileStateMachine.h"
+
+// Number and size of the coroutine frames (the frame of a body must fit in one slot, no heap is used)
+#ifndef AGILE_SM_TASK_FRAMES
+#define AGILE_SM_TASK_FRAMES 4
+#endif
+#ifndef AGILE_SM_TASK_FRAME_SIZE
+#define AGILE_SM_TASK_FRAME_SIZE 256
+#endif
+
+/*
+* Body of a CoState written as a coroutine: a sequence of steps with co_await between them.
+*
+*   StateTask blink() {
+*     for (uint8_t i = 0; i < 3; i++) {
+*       outYellow = true;
+*       co_await taskDelay(500);
+*       outYellow = false;
+*       co_await taskDelay(500);
+*     }
+*     co_await taskUntil(inButton);
+*   }
+*/
+class StateTask
+{
+public:
+	struct promise_type
+	{
+		// What the body is waiting for
+		uint32_t start = 0;
+		uint32_t time = 0;
+		bool *variable = nullptr;
+		condition_cb condition = nullptr;
+
+		StateTask get_return_object() { return StateTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		static StateTask get_return_object_on_allocation_failure() { return StateTask(); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { abort(); }
+
+		// Frames are taken from a static pool (nullptr when the pool is full or the frame is too big)
+		static void *operator new(size_t size) noexcept;
+		static void operator delete(void *frame) noexcept;
+
+		bool isReady(uint32_t now);
+	};
+	using handle_t = std::coroutine_handle<promise_type>;
+
+	StateTask() {}
+	StateTask(StateTask &&other) : m_handle(other.m_handle) { other.m_handle = nullptr; }
+	StateTask &operator=(StateTask &&other);
+	StateTask(const StateTask &) = delete;
+	StateTask &operator=(const StateTask &) = delete;
+	~StateTask() { release(); }
+
+	// False if the frame could not be allocated
+	bool isValid() const { return (bool)m_handle; }
+
+	// True when the body has reached its end
+	bool isDone() const { return m_handle && m_handle.done(); }
+
+	// Resume the body if what it's waiting for is due
+	void resume(uint32_t now);
+
+	// Time to wait before the body can be resumed (UINT32_MAX if it waits a condition or it's done)
+	uint32_t getTimeToDeadline(uint32_t now) const;
+
+	// Destroy the frame (back to the pool)
+	void release();
+
+	// Number of frames of the pool currently in use
+	static uint8_t getFramesUsed();
+
+private:
+	explicit StateTask(handle_t handle) : m_handle(handle) {}
+	handle_t m_handle;
+};
+
+
+// Awaitable for a time (milliseconds)
+struct TaskDelay
+{
+	uint32_t time;
+	bool await_ready() const { return time == 0; }
+	void await_suspend(StateTask::handle_t handle) const {
+		handle.promise().start = AgileClock::now();
+		handle.promise().time = time;
+	}
+	void await_resume() const {}
+};
+
+// Awaitable for a bool variable or a condition
+struct TaskUntil
+{
+	bool *variable;
+	condition_cb condition;
+	bool await_ready() const { return (variable != nullptr) ? *variable : condition(); }
+	void await_suspend(StateTask::handle_t handle) const {
+		handle.promise().variable = variable;
+		handle.promise().condition = condition;
+	}
+	void await_resume() const {}
+};
+
+inline TaskDelay taskDelay(uint32_t time) { return TaskDelay{time}; }
+inline TaskUntil taskUntil(bool &variable) { return TaskUntil{&variable, nullptr}; }
+inline TaskUntil taskUntil(condition_cb condition) { return TaskUntil{nullptr, condition}; }
+
+
+/*
+* State that runs a coroutine body instead of the onRunning callback: the body is started on the first run after
+* the state is entered, resumed by execute() only when its delay or condition is due and destroyed when the state is left.
+*/
+class CoState : public State
+{
+public:
+	using body_cb = StateTask (*)();
+
+	template <typename T>
+	AGILE_SM_NAME_INLINE CoState(T name, body_cb body, uint32_t min = 0, uint32_t max = 0) : State(name, min, max, nullptr, nullptr, nullptr), m_body(body)
+	{
+		m_hooks = &s_hooks;
+	}
+
+	// True when the body of the active state has reached its end
+	bool isDone() const { return m_task.isValid() && m_task.isDone(); }
+
+	// Transition trigger on the end of the body (i.e. stBlink.addTransition(stRed, CoState::done))
+	static bool done(State *state) { return static_cast<CoState *>(state)->isDone(); }
+
+private:
+	static void enter(State *state);
+	static void exit(State *state);
+	static void run(State *state);
+	static uint32_t deadline(State *state, uint32_t now);
+	static const StateHooks s_hooks;
+
+	body_cb m_body;
+	StateTask m_task;
+	bool m_ended = false;	// Body ended by the last run: transitions on done() are due
+};
+
+#endif
+#endif
@@ -0,0 +1,139 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel() {
+	memset(m_slots, 0, sizeof(m_slots));
+	m_now = AgileClock::now();
+}
+
+
+TimerWheel::~TimerWheel() {
+	for (uint8_t level = 0; level < AGILE_WHEEL_LEVELS; level++) {
+		for (uint16_t slot = 0; slot < SLOTS; slot++) {
+			while (m_slots[level][slot] != nullptr) {
+				cancel(m_slots[level][slot]);
+			}
+		}
+	}
+}
+
+
+void TimerWheel::add(StateMachine &fsm) {
+	if (fsm.m_timer == nullptr) {
+		fsm.m_timer = new WheelTimer;
+	}
+	cancel(fsm.m_timer);
+	fsm.m_timer->machine = &fsm;
+	fsm.m_timer->wheel = this;
+	fsm.updateTimer(AgileClock::now());
+}
+
+
+/*
+* The timer is placed in the level of the highest digit (AGILE_WHEEL_BITS each) where expiry and actual time are different,
+* in the slot of that digit of expiry: when the wheel reaches the slot, the timer cascades down to a lower level.
+*/
+void TimerWheel::insert(WheelTimer *timer) {
+	uint32_t expiry = timer->expiry;
+	const uint32_t range = 1UL << (AGILE_WHEEL_BITS * AGILE_WHEEL_LEVELS);
+	if (expiry - m_now >= range) {
+		// Too far: placed at the end of the wheel and rescheduled when reached
+		expiry = m_now + range - 1;
+	}
+
+	uint8_t level = 0;
+	const uint32_t diff = expiry ^ m_now;
+	while (level < AGILE_WHEEL_LEVELS - 1 && (diff >> (AGILE_WHEEL_BITS * (level + 1))) != 0) {
+		level++;
+	}
+
+	WheelTimer **head = &m_slots[level][(expiry >> (AGILE_WHEEL_BITS * level)) & MASK];
+	timer->next = *head;
+	if (timer->next != nullptr) {
+		timer->next->link = &timer->next;
+	}
+	timer->link = head;
+	*head = timer;
+}
+
+
+void TimerWheel::schedule(WheelTimer *timer, uint32_t expiry) {
+	cancel(timer);
+
+	// The actual tick is already done
+	if ((int32_t)(expiry - m_now) <= 0) {
+		expiry = m_now + 1;
+	}
+	timer->expiry = expiry;
+	insert(timer);
+	m_armed++;
+}
+
+
+void TimerWheel::unlink(WheelTimer *timer) {
+	*timer->link = timer->next;
+	if (timer->next != nullptr) {
+		timer->next->link = timer->link;
+	}
+	timer->link = nullptr;
+	timer->next = nullptr;
+}
+
+
+void TimerWheel::cancel(WheelTimer *timer) {
+	if (timer->link != nullptr) {
+		unlink(timer);
+		m_armed--;
+	}
+}
+
+
+uint32_t TimerWheel::tick() {
+	uint32_t fired = 0;
+	m_now++;
+
+	// Cascade the timers of higher levels, from the highest one (lower digits of time are zero)
+	for (int8_t level = AGILE_WHEEL_LEVELS - 1; level > 0; level--) {
+		if ((m_now & ((1UL << (AGILE_WHEEL_BITS * level)) - 1)) != 0) {
+			continue;
+		}
+		WheelTimer **head = &m_slots[level][(m_now >> (AGILE_WHEEL_BITS * level)) & MASK];
+		while (*head != nullptr) {
+			WheelTimer *timer = *head;
+			unlink(timer);
+			insert(timer);
+		}
+	}
+
+	// Expired timers: the machine is executed and reschedules its next deadline
+	WheelTimer **head = &m_slots[0][m_now & MASK];
+	while (*head != nullptr) {
+		WheelTimer *timer = *head;
+		cancel(timer);
+		if (timer->expiry == m_now) {
+			timer->machine->execute();
+			fired++;
+		}
+		else {
+			schedule(timer, timer->expiry);
+		}
+	}
+	return fired;
+}
+
+
+uint32_t TimerWheel::run() {
+	CachedCondition::nextTick();
+	const uint32_t now = AgileClock::now();
+	uint32_t fired = 0;
+
+	// Nothing armed: no need to walk the slots
+	if (m_armed == 0) {
+		m_now = now;
+		return 0;
+	}
+
+	while (m_now != now) {
+		fired += tick();
+	}
+	return fired;
+}
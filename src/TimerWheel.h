@@ -0,0 +1,78 @@
+/*
+	Cotesta Tolentino, 2020.
+	Released into the public domain.
+*/
+#ifndef AGILE_TIMER_WHEEL_H
+#define AGILE_TIMER_WHEEL_H
+#include "Arduino.h"
+
+class StateMachine;
+class TimerWheel;
+
+// Slots of each level are 2^AGILE_WHEEL_BITS (1 ms resolution)
+#ifndef AGILE_WHEEL_BITS
+#define AGILE_WHEEL_BITS 5
+#endif
+
+// Levels of the wheel: deadlines up to 2^(AGILE_WHEEL_BITS * AGILE_WHEEL_LEVELS) ms are placed directly, longer ones are rescheduled
+#ifndef AGILE_WHEEL_LEVELS
+#define AGILE_WHEEL_LEVELS 4
+#endif
+
+// Deadline of a machine inside the wheel (intrusive node, linked in the slot list)
+struct WheelTimer
+{
+	WheelTimer *next = nullptr;
+	WheelTimer **link = nullptr;	// Pointer that points to this node (nullptr if not armed)
+	uint32_t expiry = 0;
+	StateMachine *machine = nullptr;
+	TimerWheel *wheel = nullptr;
+};
+
+/*
+* Hierarchical timer wheel shared by many machines.
+* Each machine keeps only the nearest deadline of its active state (min/max time, timed transitions, L/D actions):
+* it's registered on state entry, updated after every execute() and cancelled on exit.
+* run() calls execute() only for the machines with an expired deadline, so the cost of a tick is proportional
+* to the expired timers and not to the armed ones. Inputs (bool variables and callbacks) are not timers:
+* call execute() of the machine when they change, or keep calling it in loop().
+* The wheel must remain valid while the machines added are in use.
+*/
+class TimerWheel
+{
+public:
+	TimerWheel();
+	~TimerWheel();
+
+	// Schedule the deadlines of the machine in this wheel
+	void add(StateMachine &fsm);
+
+	// Execute the machines with an expired deadline: returns the number of machines executed
+	uint32_t run();
+
+	// Number of deadlines armed
+	uint32_t getArmed() const { return m_armed; }
+
+private:
+	friend class StateMachine;
+
+	static_assert(AGILE_WHEEL_BITS > 0 && AGILE_WHEEL_BITS < 16, "AGILE_WHEEL_BITS must be 1..15");
+	static_assert(AGILE_WHEEL_BITS * AGILE_WHEEL_LEVELS < 32, "Range of the wheel must fit in 32 bits of time");
+	static const uint16_t SLOTS = 1 << AGILE_WHEEL_BITS;
+	static const uint16_t MASK = SLOTS - 1;
+
+	void schedule(WheelTimer *timer, uint32_t expiry);
+	void cancel(WheelTimer *timer);
+	void unlink(WheelTimer *timer);
+	void insert(WheelTimer *timer);
+	uint32_t tick();
+
+	WheelTimer *m_slots[AGILE_WHEEL_LEVELS][SLOTS];
+	uint32_t m_now;
+	uint32_t m_armed = 0;
+};
+
+// After TimerWheel: the engine sources included by AgileStateMachine.h (header-only builds) need it
+#include "AgileStateMachine.h"
+
+#endif
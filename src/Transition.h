@@ -2,14 +2,32 @@
 #define AGILE_TRANSITION_H
 #pragma once
 #include "Arduino.h"
+#include "Clock.h"
+#include "CachedCondition.h"
+#include "EventBus.h"
 
 class State;
+class Transition;
 
-using condition_cb = bool (*)();
+// Trigger condition that needs the state object (i.e. a member function of a StateImpl class)
+using guard_cb = bool (*)(State *state);
+
+// Called when more transitions of the same state trigger in the same tick (taken is the one with higher priority)
+using conflict_cb = void (*)(State *state, Transition *taken, Transition *other);
 
 class Transition
 {
 public:
+    // Kind of trigger condition
+    enum Trigger
+    {
+        ON_VARIABLE,
+        ON_CALLBACK,
+        ON_TIMEOUT,
+        ON_GUARD,
+        ON_EVENT
+    };
+
     ~Transition() {}
 
     // Costruttore con riferimento a stato e variabile booleana
@@ -28,8 +46,39 @@ public:
 
     Transition(State *out, uint32_t timeout) : m_outState(*out), m_timeout(timeout) {}
 
+    // Trigger with a guard of the state that owns the transition
+    Transition(State *out, guard_cb guard) : m_outState(*out), m_guard(guard) {}
+
+    // Trigger with a condition evaluated once per tick
+    Transition(State *out, CachedCondition &condition) : m_outState(*out), m_cached(&condition) {}
+
+    // Trigger with an event received from an EventBus
+    Transition(State *out, AgileEvent event) : m_outState(*out), m_event(event.id) {}
+
     bool trigger(uint32_t enterTime)
     {
+        return trigger(enterTime, AgileClock::now());
+    }
+
+    // Same as trigger(enterTime), but with the time of current tick already read by the engine
+    // (and the state that owns the transition, the event handled in this tick or -1)
+    bool trigger(uint32_t enterTime, uint32_t now, State *owner = nullptr, int16_t event = -1)
+    {
+        if (m_event >= 0)
+        {
+            return event == m_event;
+        }
+
+        if (m_guard != nullptr)
+        {
+            return owner != nullptr && m_guard(owner);
+        }
+
+        if (m_cached != nullptr)
+        {
+            return m_cached->get(now);
+        }
+
         // Trigger su funzione callback
         if (m_trigger_cb != nullptr)
         {
@@ -45,7 +94,7 @@ public:
         // Trigger su timeout
         else if (m_timeout > 0)
         {
-            if (millis() - enterTime >= m_timeout)
+            if (now - enterTime >= m_timeout)
             {
                 return true;
             }
@@ -59,11 +108,61 @@ public:
         return &m_outState;
     }
 
+    uint8_t getTriggerType() const
+    {
+        if (m_event >= 0)
+            return ON_EVENT;
+        if (m_guard != nullptr)
+            return ON_GUARD;
+        if (m_cached != nullptr)
+            return ON_CALLBACK;
+        return m_trigger_cb != nullptr ? ON_CALLBACK : (m_trigger_var != nullptr ? ON_VARIABLE : ON_TIMEOUT);
+    }
+
+    bool *getTriggerVariable() const { return m_trigger_var; }
+    condition_cb getTriggerCallback() const { return m_cached != nullptr ? m_cached->getCallback() : m_trigger_cb; }
+    guard_cb getTriggerGuard() const { return m_guard; }
+    CachedCondition *getTriggerCached() const { return m_cached; }
+    int16_t getTriggerEvent() const { return m_event; }
+
+    // Publish event on bus when the transition is taken (after the exit of the state, before the entry of the next one)
+    Transition *emit(EventBus &bus, AgileEvent event, const void *payload = nullptr)
+    {
+        m_emitBus = &bus;
+        m_emitEvent = event.id;
+        m_emitPayload = payload;
+        return this;
+    }
+
+    // Transitions with higher priority are evaluated first (same priority: in the order they were added)
+    Transition *setPriority(uint8_t priority)
+    {
+        m_priority = priority;
+        return this;
+    }
+
+    uint8_t getPriority() const { return m_priority; }
+
+    // Timeout of transition (0 if triggered by variable or callback)
+    uint32_t getTimeout() const
+    {
+        return (m_trigger_cb == nullptr && m_trigger_var == nullptr && m_guard == nullptr && m_cached == nullptr && m_event < 0) ? m_timeout : 0;
+    }
+
 protected:
     State &m_outState; // Ora è un riferimento invece di un puntatore
     bool *m_trigger_var = nullptr;
     condition_cb m_trigger_cb = nullptr;
+    guard_cb m_guard = nullptr;
+    CachedCondition *m_cached = nullptr;
     uint32_t m_timeout = 0;
+    uint8_t m_priority = 0;
+    int16_t m_event = -1;
+
+    friend class StateMachine;
+    EventBus *m_emitBus = nullptr;
+    const void *m_emitPayload = nullptr;
+    uint8_t m_emitEvent = 0;
 };
 
 #endif